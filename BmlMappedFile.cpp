@@ -0,0 +1,74 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BmlMappedFile.h"
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+using namespace Stream;
+
+BmlMappedFile::BmlMappedFile():d_map(0),d_size(0)
+{
+}
+
+BmlMappedFile::BmlMappedFile( const QString& path ):d_map(0),d_size(0)
+{
+	open( path );
+}
+
+BmlMappedFile::~BmlMappedFile()
+{
+	close();
+}
+
+bool BmlMappedFile::open( const QString& path )
+{
+	close();
+	d_file.setFileName( path );
+	if( !d_file.open( QIODevice::ReadOnly ) )
+		return false;
+	d_size = d_file.size();
+	if( d_size > 0 )
+	{
+		d_map = d_file.map( 0, d_size );
+		if( d_map == 0 )
+		{
+			d_file.close();
+			d_size = 0;
+			return false;
+		}
+#if defined( Q_OS_UNIX ) && defined( MADV_SEQUENTIAL )
+		// Die Datei wird von vorne nach hinten gelesen; der Kernel soll vorauslesen und
+		// gelesene Seiten frh freigeben. Fehler hier sind nicht kritisch.
+		::madvise( d_map, d_size, MADV_SEQUENTIAL );
+#endif
+	}
+	setData( (const char*)d_map, d_size );
+	return true;
+}
+
+void BmlMappedFile::close()
+{
+	setData( 0, 0 );
+	if( d_map )
+		d_file.unmap( d_map );
+	d_map = 0;
+	d_size = 0;
+	d_file.close();
+}
@@ -0,0 +1,52 @@
+#ifndef __stream_bmlmappedfile__
+#define __stream_bmlmappedfile__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Stream/BmlView.h>
+#include <QFile>
+
+namespace Stream
+{
+	// Liest eine BML-Datei ber QFile::map statt ber den Lesepuffer von QIODevice. Die Tokens
+	// werden mit BmlView gelesen; getValueData und getNameStr zeigen direkt in die Abbildung,
+	// sofern die Zelle nicht komprimiert ist. Die Slices sind nur bis close() gltig.
+	class BmlMappedFile : public BmlView
+	{
+	public:
+		BmlMappedFile();
+		BmlMappedFile( const QString& path ); // Siehe isOpen
+		~BmlMappedFile();
+
+		bool open( const QString& path ); // false..Datei nicht lesbar oder nicht abbildbar
+		void close();
+		bool isOpen() const { return d_file.isOpen(); }
+		QString errorString() const { return d_file.errorString(); }
+		quint64 getSize() const { return d_size; }
+	private:
+		BmlMappedFile( const BmlMappedFile& ):BmlView() {}
+		BmlMappedFile& operator=( const BmlMappedFile& ) { return *this; }
+		QFile d_file;
+		uchar* d_map;
+		quint64 d_size;
+	};
+}
+
+#endif // __stream_bmlmappedfile__
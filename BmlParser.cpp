@@ -0,0 +1,460 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BmlParser.h"
+#include "Helper.h"
+#include <Stream/Exceptions.h>
+using namespace Stream;
+
+DataCell BmlParser::Name::toCell() const
+{
+	DataCell res;
+	switch( d_type )
+	{
+	case DataCell::TypeAtom:
+		res.setAtom( d_id );
+		break;
+	case DataCell::TypeTag:
+		res.setTag( NameTag( d_id ) );
+		break;
+	case DataCell::TypeAscii:
+		res.setLatin1( getStr() ); // wie DataReader
+		break;
+	case DataCell::TypeId32:
+		res.setId32( d_id );
+		break;
+	default:
+		res.setNull();
+	}
+	return res;
+}
+
+BmlParser::BmlParser( Handler* h ):d_handler( h )
+{
+	reset();
+}
+
+void BmlParser::reset()
+{
+	d_buf.clear();
+	d_need = 0;
+	d_chunks = 0;
+	d_names = d_table;
+	d_scopes.clear();
+	d_level = 0;
+}
+
+void BmlParser::setNameTable( const NameTable& t )
+{
+	d_table = t.getNames();
+	reset();
+}
+
+void BmlParser::feed( const char* data, quint32 len )
+{
+	// Zuerst das angefangene Token vervollstndigen. Es wird nur bis d_need angehngt und danach
+	// direkt ab data weitergeparst. Ist die Lnge noch unbekannt, ist d_need nur eine untere
+	// Schranke, und das Token wird in kleinen Schritten erneut geparst.
+	while( !d_buf.isEmpty() && len > 0 )
+	{
+		quint32 n = len;
+		if( d_need > quint32(d_buf.size()) )
+			n = qMin( len, d_need - d_buf.size() );
+		d_buf.append( data, n );
+		data += n;
+		len -= n;
+		if( quint32(d_buf.size()) < d_need )
+			return;
+		d_buf.remove( 0, parse( d_buf.constData(), d_buf.size() ) );
+	}
+	if( len == 0 )
+		return;
+	const quint32 n = parse( data, len );
+	if( n < len )
+		d_buf.append( data + n, len - n );
+}
+
+quint32 BmlParser::parse( const char* data, quint32 len )
+{
+	quint32 pos = 0;
+	while( pos < len )
+	{
+		const quint32 n = parseToken( data + pos, len - pos );
+		if( n == 0 )
+			break; // Token noch nicht vollstndig; d_need ist gesetzt
+		pos += n;
+	}
+	return pos;
+}
+
+quint32 BmlParser::parseToken( const char* p, quint32 left )
+{
+	// Gleiche Logik wie BmlView::fetchNext; 0..Token unvollstndig
+	d_need = 0;
+	const DataCell::DataType type = DataCell::symToType( p[0] ); // throws
+	Name name;
+	bool isNew = false;
+
+	if( type == DataCell::FrameStart || type == DataCell::FrameStartSized )
+	{
+		const quint32 h = ( type == DataCell::FrameStartSized )?1 + sizeof(quint32):1;
+		if( left <= h )
+		{
+			d_need = h + 1; // Es folgt mindestens noch ein Name oder FrameEnd
+			return 0;
+		}
+		int n = 0;
+		if( DataCell::isFrameNameSym( p[h] ) )
+		{
+			n = readName( p + h, left - h, name, isNew );
+			if( n < 0 )
+			{
+				if( d_need != 0 )
+					d_need += h;
+				return 0;
+			}
+		}
+		if( isNew )
+			d_names.append( name.getStr() );
+		// Namen aus einem Frame mit Lnge gelten wie beim Writer nur darin
+		quint32 len = 0;
+		if( type == DataCell::FrameStartSized )
+			Helper::read( p + 1, len );
+		d_scopes.append( ( len != 0 )?d_names.size():-1 );
+		d_level++;
+		if( d_handler )
+			d_handler->beginFrame( name );
+		return h + n;
+	}else if( type == DataCell::FrameEnd )
+	{
+		if( d_level <= 0 )
+			throw StreamException( StreamException::InvalidProtocol, "BmlParser: unbalanced frame end" );
+		d_level--;
+		const int names = ( d_scopes.isEmpty() )?-1:d_scopes.takeLast();
+		while( names >= 0 && d_names.size() > names )
+			d_names.removeLast();
+		if( d_handler )
+			d_handler->endFrame();
+		return 1;
+	}else if( type == DataCell::FramePacked )
+	{
+		const DataCell::Peek peek = DataCell::peekCell( p, left ); // throws
+		if( !peek.isValid() )
+		{
+			d_need = left + 1; // Header unvollstndig
+			return 0;
+		}
+		if( left < peek.getCellLength() )
+		{
+			d_need = peek.getCellLength();
+			return 0;
+		}
+		// Der entpackte Rest des Frames ist vollstndig und endet mit FrameEnd
+		const QByteArray body = Codec::unpack( p + peek.getHeaderLength(), peek.d_len ); // throws
+		const int names = d_names.size();
+		const qint16 level = d_level;
+		if( parse( body.constData(), body.size() ) != quint32(body.size()) || d_level != level - 1 )
+			throw StreamException( StreamException::InvalidProtocol, "BmlParser: invalid packed frame" );
+		d_need = 0;
+		// Die im komprimierten Frame definierten Namen gelten wie beim Writer nur darin
+		while( d_names.size() > names )
+			d_names.removeLast();
+		return peek.getCellLength();
+	}else
+	{
+		int n = 0;
+		if( DataCell::isSlotNameSym( p[0] ) )
+		{
+			n = readName( p, left, name, isNew );
+			if( n < 0 )
+				return 0;
+		}
+		if( left > quint32(n) && DataCell::symToType( p[n] ) == DataCell::LobChunked &&
+			peekChunks( p + n, left - n ) == 0 )
+		{
+			d_need += n;
+			return 0;
+		}
+		const DataCell::Peek peek = DataCell::peekCell( p + n, left - n ); // throws
+		if( !peek.isValid() )
+		{
+			d_need = left + 1; // Header unvollstndig
+			return 0;
+		}
+		if( left - n < peek.getCellLength() )
+		{
+			d_need = n + peek.getCellLength();
+			return 0;
+		}
+		if( isNew )
+			d_names.append( name.getStr() );
+		dispatch( name, p + n, peek );
+		return n + peek.getCellLength();
+	}
+}
+
+int BmlParser::readName( const char* data, quint32 len, Name& name, bool& isNew )
+{
+	const DataCell::Peek peek = DataCell::peekCell( data, len ); // throws
+	if( !peek.isValid() )
+	{
+		d_need = len + 1; // Header unvollstndig
+		return -1;
+	}
+	if( len < peek.getCellLength() )
+	{
+		d_need = peek.getCellLength();
+		return -1;
+	}
+	const char* payload = data + peek.getHeaderLength();
+	switch( peek.d_type )
+	{
+	case DataCell::FrameName:
+	case DataCell::SlotName:
+		name.d_type = DataCell::TypeAtom;
+		Helper::read( payload, name.d_id );
+		break;
+	case DataCell::FrameNameTag:
+	case DataCell::SlotNameTag:
+		name.d_type = DataCell::TypeTag;
+		::memcpy( &name.d_id, payload, NameTag::Size );
+		break;
+	case DataCell::FrameNameStr:
+	case DataCell::SlotNameStr:
+		// Wird erst in die Stringtabelle kopiert, wenn das ganze Token da ist
+		name.d_type = DataCell::TypeAscii;
+		name.d_id = d_names.size();
+		name.d_str = payload;
+		name.d_len = qstrnlen( payload, peek.d_len );
+		isNew = true;
+		break;
+	case DataCell::FrameNameIdx:
+	case DataCell::SlotNameIdx:
+		Helper::readMultibyte32( payload, name.d_id, peek.d_len );
+		if( name.d_id < quint32(d_names.size()) )
+		{
+			name.d_type = DataCell::TypeAscii;
+			name.d_str = d_names[name.d_id].constData();
+			name.d_len = d_names[name.d_id].size();
+		}else
+			name.d_type = DataCell::TypeId32;
+		break;
+	default:
+		Q_ASSERT( false );
+	}
+	return peek.getCellLength();
+}
+
+quint32 BmlParser::peekChunks( const char* cell, quint32 len )
+{
+	// cell zeigt auf das Typsymbol eines LobChunked. Prft die Stcke ab d_chunks; so wird ein
+	// angefangener LOB bei jedem feed nur um die neuen Stcke weitergeprft, statt von vorne.
+	// Lnge der Zelle oder 0..es fehlen noch Bytes, d_need ist dann relativ zu cell gesetzt.
+	quint32 pos = 1 + d_chunks;
+	while( pos < len )
+	{
+		if( DataCell::symToType( cell[pos] ) != DataCell::TypeLob )
+			throw StreamException( StreamException::InvalidProtocol, "invalid LOB chunk" );
+		const int n = Helper::peekMultibyte32( cell + pos + 1, len - pos - 1 );
+		if( n < 0 )
+		{
+			d_need = len + 1; // Header des Stcks unvollstndig
+			return 0;
+		}
+		quint32 count;
+		Helper::readMultibyte32( cell + pos + 1, count, n );
+		const quint64 end = quint64(pos) + 1 + n + count;
+		if( end > len )
+		{
+			// Das Stck und danach mindestens der Header des nchsten
+			d_need = ( count == 0 )?end:end + 2;
+			return 0;
+		}
+		pos = end;
+		if( count == 0 )
+		{
+			d_chunks = 0;
+			return pos; // Leeres Stck schliesst ab
+		}
+		d_chunks = pos - 1;
+	}
+	d_need = pos + 2; // Typsymbol und Anzahl des nchsten Stcks
+	return 0;
+}
+
+void BmlParser::dispatch( const Name& name, const char* cell, const DataCell::Peek& peek )
+{
+	if( d_handler == 0 )
+		return;
+	const char* payload = cell + peek.getHeaderLength();
+	switch( peek.d_type )
+	{
+	case DataCell::TypeNull:
+		d_handler->slotNull( name );
+		break;
+	case DataCell::TypeTrue:
+		d_handler->slot( name, true );
+		break;
+	case DataCell::TypeFalse:
+		d_handler->slot( name, false );
+		break;
+	case DataCell::TypeUInt8:
+		{
+			quint8 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeUInt16:
+		{
+			quint16 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeInt32:
+		{
+			qint32 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeUInt32:
+		{
+			quint32 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeInt64:
+		{
+			qint64 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeUInt64:
+		{
+			quint64 v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeFloat:
+		{
+			float v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeDouble:
+		{
+			double v;
+			Helper::read( payload, v );
+			d_handler->slot( name, v );
+		}
+		break;
+	case DataCell::TypeTag:
+		{
+			quint32 v;
+			::memcpy( &v, payload, NameTag::Size );
+			d_handler->slot( name, NameTag( v ) );
+		}
+		break;
+	case DataCell::TypeAtom:
+		{
+			quint32 v;
+			Helper::read( payload, v );
+			d_handler->slotId( name, peek.d_type, v );
+		}
+		break;
+	case DataCell::TypeSid:
+	case DataCell::TypeId32:
+		{
+			quint32 v;
+			Helper::readMultibyte32( payload, v, peek.d_len );
+			d_handler->slotId( name, peek.d_type, v );
+		}
+		break;
+	case DataCell::TypeOid:
+	case DataCell::TypeRid:
+	case DataCell::TypeId64:
+		{
+			quint64 v;
+			Helper::readMultibyte64( payload, v, peek.d_len );
+			d_handler->slotId( name, peek.d_type, v );
+		}
+		break;
+	case DataCell::TypeDate:
+	case DataCell::TypeTime:
+	case DataCell::TypeDateTime:
+	case DataCell::TypeTimeSlot:
+	case DataCell::TypeUuid:
+		// Diese Formate werden weiterhin von DataCell dekodiert
+		d_tmp.readCell( cell, peek.getCellLength() );
+		switch( peek.d_type )
+		{
+		case DataCell::TypeDate:
+			d_handler->slot( name, d_tmp.getDate() );
+			break;
+		case DataCell::TypeTime:
+			d_handler->slot( name, d_tmp.getTime() );
+			break;
+		case DataCell::TypeDateTime:
+			d_handler->slot( name, d_tmp.getDateTime() );
+			break;
+		case DataCell::TypeTimeSlot:
+			d_handler->slot( name, d_tmp.getTimeSlot() );
+			break;
+		default:
+			d_handler->slot( name, d_tmp.getUuid() );
+		}
+		d_tmp.clear();
+		break;
+	case DataCell::LobChunked:
+		// Der Parser puffert angefangene Tokens; der LOB ist hier darum ganz vorhanden
+		d_tmp.readCell( cell, peek.getCellLength() );
+		{
+			const QByteArray lob = d_tmp.getArr();
+			d_handler->slotData( name, DataCell::TypeLob, lob.constData(), lob.size() );
+		}
+		d_tmp.clear();
+		break;
+	default:
+		{
+			const int len = DataCell::typeByteCount[ peek.d_type ];
+			if( len != DataCell::UNISTR && len != DataCell::CSTRING && len != DataCell::BINARY )
+				throw StreamException( StreamException::IncompleteImplementation,
+					"BmlParser: type not supported" );
+			QByteArray tmp;
+			const char* data = payload;
+			quint32 count = peek.d_len;
+			if( DataCell::symIsCompressed( cell[0] ) )
+			{
+				tmp = DataCell::uncompress( payload, peek.d_len );
+				data = tmp.constData();
+				count = tmp.size();
+			}
+			if( len != DataCell::BINARY )
+				count = qstrnlen( data, count );
+			d_handler->slotData( name, peek.d_type, data, count );
+		}
+		break;
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef __stream_bmlparser__
+#define __stream_bmlparser__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Stream/DataCell.h>
+#include <Stream/NameTable.h>
+#include <QList>
+
+namespace Stream
+{
+	// Value Class
+	// Push-Parser fr BML. Die Daten werden in beliebigen Stcken mit feed bergeben; der Parser
+	// ruft fr jedes vollstndige Token den Handler auf. Nur ein angefangenes Token wird zwischen
+	// zwei feed-Aufrufen gepuffert.
+	class BmlParser
+	{
+	public:
+		// Name eines Frames oder Slots. Zeiger sind nur whrend des Callbacks gltig.
+		struct Name
+		{
+			// TypeNull, TypeAtom, TypeTag, TypeAscii oder TypeId32 (Index ausserhalb der Stringtabelle)
+			DataCell::DataType d_type;
+			quint32 d_id; // Atom, Tag oder Index
+			const char* d_str; // Bei TypeAscii, ohne Nullzeichen
+			quint32 d_len;
+			Name():d_type(DataCell::TypeNull),d_id(0),d_str(0),d_len(0) {}
+			bool isNull() const { return d_type == DataCell::TypeNull; }
+			DataCell::Atom getAtom() const { return ( d_type == DataCell::TypeAtom )?d_id:0; }
+			NameTag getTag() const { return ( d_type == DataCell::TypeTag )?NameTag(d_id):NameTag::null; }
+			QByteArray getStr() const { return QByteArray( d_str, d_len ); }
+			DataCell toCell() const; // Wie DataReader::getName()
+		};
+
+		// Die Default-Implementationen ignorieren das Token.
+		class Handler
+		{
+		public:
+			virtual ~Handler() {}
+			virtual void beginFrame( const Name& ) {}
+			virtual void endFrame() {}
+			virtual void slotNull( const Name& ) {}
+			virtual void slot( const Name&, bool ) {}
+			virtual void slot( const Name&, quint8 ) {}
+			virtual void slot( const Name&, quint16 ) {}
+			virtual void slot( const Name&, qint32 ) {}
+			virtual void slot( const Name&, quint32 ) {}
+			virtual void slot( const Name&, qint64 ) {}
+			virtual void slot( const Name&, quint64 ) {}
+			virtual void slot( const Name&, float ) {}
+			virtual void slot( const Name&, double ) {}
+			virtual void slot( const Name&, NameTag ) {}
+			virtual void slot( const Name&, const QDate& ) {}
+			virtual void slot( const Name&, const QTime& ) {}
+			virtual void slot( const Name&, const QDateTime& ) {}
+			virtual void slot( const Name&, const TimeSlot& ) {}
+			virtual void slot( const Name&, const QUuid& ) {}
+			// TypeAtom, TypeOid, TypeRid, TypeSid, TypeId32 und TypeId64
+			virtual void slotId( const Name&, DataCell::DataType, quint64 ) {}
+			// Strings (TypeString, TypeHtml und TypeXml als UTF-8), TypeLob, TypeBml, TypeUrl,
+			// TypeImg und TypePic. Bereits dekomprimiert und ohne Nullzeichen; nur whrend
+			// des Callbacks gltig.
+			virtual void slotData( const Name&, DataCell::DataType, const char*, quint32 ) {}
+		};
+
+		BmlParser( Handler* = 0 );
+		void setHandler( Handler* h ) { d_handler = h; }
+		Handler* getHandler() const { return d_handler; }
+		void reset();
+		// Dieselbe Tabelle wie beim Writer (siehe NameTable); gilt auch nach reset. Macht reset.
+		void setNameTable( const NameTable& );
+
+		void feed( const char* data, quint32 len );
+		void feed( const QByteArray& data ) { feed( data.constData(), data.size() ); }
+
+		qint16 getLevel() const { return d_level; }
+		bool isPending() const { return !d_buf.isEmpty(); } // Ein Token ist angefangen
+	private:
+		quint32 parse( const char* data, quint32 len );
+		quint32 parseToken( const char* data, quint32 len );
+		int readName( const char* data, quint32 len, Name&, bool& isNew );
+		quint32 peekChunks( const char* cell, quint32 len );
+		void dispatch( const Name&, const char* cell, const DataCell::Peek& );
+		Handler* d_handler;
+		QByteArray d_buf; // Angefangenes Token
+		quint32 d_need; // Lnge des angefangenen Tokens oder, falls noch unbekannt, eine untere Schranke
+		quint32 d_chunks; // Bei angefangenem LobChunked Lnge der bereits geprften Stcke
+		QList<QByteArray> d_names;
+		QList<QByteArray> d_table; // Namen der NameTable
+		QList<int> d_scopes; // Pro offenem Frame Anzahl d_names nach dessen Namen oder -1
+		DataCell d_tmp;
+		qint16 d_level;
+	};
+}
+
+#endif // __stream_bmlparser__
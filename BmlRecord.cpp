@@ -20,28 +20,57 @@
 #include "BmlRecord.h"
 #include "DataReader.h"
 #include <QtDebug>
+#include <algorithm>
 using namespace Stream;
 
-BmlRecord::BmlRecord( const QByteArray& v )
+static inline int _compare( const BmlRecord::Slot& s, quint8 kind, quint32 id, const QByteArray& name )
+{
+	if( s.d_kind != kind )
+		return ( s.d_kind < kind )?-1:1;
+	if( kind == BmlRecord::Slot::String )
+		return ( s.d_name < name )?-1:( ( name < s.d_name )?1:0 );
+	if( s.d_id != id )
+		return ( s.d_id < id )?-1:1;
+	return 0;
+}
+
+static inline bool _less( const BmlRecord::Slot& lhs, const BmlRecord::Slot& rhs )
+{
+	return _compare( lhs, rhs.d_kind, rhs.d_id, rhs.d_name ) < 0;
+}
+
+BmlRecord::BmlRecord( const BmlRecord& rhs ):
+	d_array(rhs.d_array),d_atoms(this),d_tags(this),d_strings(this),d_slots(rhs.d_slots)
+{
+}
+
+BmlRecord::BmlRecord( const QByteArray& v ):d_atoms(this),d_tags(this),d_strings(this)
 {
 	readFrom( v );
 }
 
-BmlRecord::BmlRecord( const DataCell& v )
+BmlRecord::BmlRecord( const DataCell& v ):d_atoms(this),d_tags(this),d_strings(this)
 {
 	readFrom( v );
 }
 
+BmlRecord& BmlRecord::operator=( const BmlRecord& rhs )
+{
+	// Die MapViews zeigen weiterhin auf this
+	d_array = rhs.d_array;
+	d_slots = rhs.d_slots;
+	return *this;
+}
+
 void BmlRecord::clear()
 {
 	d_array.clear();
-	d_atoms.clear();
-	d_tags.clear();
-	d_strings.clear();
+	d_slots.clear();
 }
 
 void BmlRecord::readFrom( const QByteArray& bml )
 {
+	// Zuerst alles anhngen, dann einmal sortieren statt pro Slot einzufgen
 	DataReader r( bml );
 	DataReader::Token t = r.nextToken();
 	while( t == DataReader::Slot )
@@ -49,13 +78,15 @@ void BmlRecord::readFrom( const QByteArray& bml )
 		if( r.getName().isNull() )
 			d_array.append( r.readValue() );
 		else if( r.getName().getType() == DataCell::TypeAtom )
-			d_atoms[ r.getName().getAtom() ] = r.readValue();
+			append( Slot::Atom, r.getName().getAtom(), QByteArray(), r.readValue() );
 		else if( r.getName().getType() == DataCell::TypeTag )
-			d_tags[ r.getName().getTag() ] = r.readValue();
-		else if( r.getName().getType() == DataCell::TypeAscii )
-			d_strings[ r.getName().getArr() ] = r.readValue();
+			append( Slot::Tag, r.getName().getTag().d_id, QByteArray(), r.readValue() );
+		else if( r.getName().getType() == DataCell::TypeAscii ||
+				 r.getName().getType() == DataCell::TypeLatin1 ) // Wiederholte Namen kommen als Latin1
+			append( Slot::String, 0, r.getName().getArr(), r.readValue() );
 		t = r.nextToken();
 	}
+	normalize();
 }
 
 void BmlRecord::readFrom( const DataCell& bml )
@@ -65,16 +96,137 @@ void BmlRecord::readFrom( const DataCell& bml )
 		readFrom( bml.getArr() );
 }
 
+void BmlRecord::append( quint8 kind, quint32 id, const QByteArray& name, const DataCell& v )
+{
+	d_slots.append( Slot() );
+	Slot& s = d_slots.last();
+	s.d_kind = kind;
+	s.d_id = id;
+	s.d_name = name;
+	s.d_value = v;
+}
+
+void BmlRecord::normalize()
+{
+	// Stabil sortieren; bei gleichem Namen gewinnt wie bei QMap der zuletzt gelesene Wert
+	std::stable_sort( d_slots.begin(), d_slots.end(), _less );
+	int out = 0;
+	for( int i = 0; i < d_slots.size(); i++ )
+	{
+		if( out > 0 && _compare( d_slots[out-1], d_slots[i].d_kind, d_slots[i].d_id,
+								 d_slots[i].d_name ) == 0 )
+			d_slots[out-1] = d_slots[i];
+		else
+		{
+			if( out != i )
+				d_slots[out] = d_slots[i];
+			out++;
+		}
+	}
+	d_slots.resize( out );
+}
+
+int BmlRecord::lowerBound( quint8 kind, quint32 id, const QByteArray& name ) const
+{
+	const int n = d_slots.size();
+	if( n <= LinearMax )
+	{
+		int i = 0;
+		while( i < n && _compare( d_slots[i], kind, id, name ) < 0 )
+			i++;
+		return i;
+	}
+	int lo = 0;
+	int hi = n;
+	while( lo < hi )
+	{
+		const int mid = lo + ( hi - lo ) / 2;
+		if( _compare( d_slots[mid], kind, id, name ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int BmlRecord::find( quint8 kind, quint32 id, const QByteArray& name ) const
+{
+	const int i = lowerBound( kind, id, name );
+	if( i < d_slots.size() && _compare( d_slots[i], kind, id, name ) == 0 )
+		return i;
+	else
+		return -1;
+}
+
+void BmlRecord::range( quint8 kind, int& from, int& to ) const
+{
+	// Atom hat id 0 und leeren Namen als kleinsten Schlssel; String den leeren Namen
+	from = lowerBound( kind, 0, QByteArray() );
+	to = ( kind == Slot::String )?d_slots.size():lowerBound( kind + 1, 0, QByteArray() );
+}
+
+DataCell& BmlRecord::insert( quint8 kind, quint32 id, const QByteArray& name )
+{
+	const int i = lowerBound( kind, id, name );
+	if( i < d_slots.size() && _compare( d_slots[i], kind, id, name ) == 0 )
+		return d_slots[i].d_value;
+	Slot s;
+	s.d_kind = kind;
+	s.d_id = id;
+	s.d_name = name;
+	d_slots.insert( i, s );
+	return d_slots[i].d_value;
+}
+
+int BmlRecord::remove( quint8 kind, quint32 id, const QByteArray& name )
+{
+	const int i = find( kind, id, name );
+	if( i == -1 )
+		return 0;
+	d_slots.remove( i );
+	return 1;
+}
+
+void BmlRecord::clearKind( quint8 kind )
+{
+	int from, to;
+	range( kind, from, to );
+	for( int i = from; i < to; i++ )
+		d_slots.remove( from );
+}
+
+const DataCell* BmlRecord::findAtom( quint32 a ) const
+{
+	const int i = find( Slot::Atom, a, QByteArray() );
+	return ( i == -1 )?0:&d_slots[i].d_value;
+}
+
+const DataCell* BmlRecord::findTag( const NameTag& t ) const
+{
+	const int i = find( Slot::Tag, t.d_id, QByteArray() );
+	return ( i == -1 )?0:&d_slots[i].d_value;
+}
+
+const DataCell* BmlRecord::findString( const QByteArray& s ) const
+{
+	const int i = find( Slot::String, 0, s );
+	return ( i == -1 )?0:&d_slots[i].d_value;
+}
+
 void BmlRecord::dump()
 {
 	qDebug( "*** BmlRecord start" );
 	for( int i = 0; i < d_array.size(); i++ )
 		qDebug() << i << " = " << d_array[i].toPrettyString();
-	for( QMap<quint32,DataCell>::const_iterator j = d_atoms.begin(); j != d_atoms.end(); ++j )
-		qDebug() << QString("atom(0x%1)").arg( j.key(), 0, 16 ) << " = " << j.value().toPrettyString();
-	for( QMap<NameTag,DataCell>::const_iterator k = d_tags.begin(); k != d_tags.end(); ++k )
-		qDebug() << "tag(" << k.key().toString() << ") = " << k.value().toPrettyString();
-	for( QMap<QByteArray,DataCell>::const_iterator l = d_strings.begin(); l != d_strings.end(); ++l )
-		qDebug() << l.key() << " = " << l.value().toPrettyString();
+	for( int j = 0; j < d_slots.size(); j++ )
+	{
+		const Slot& s = d_slots[j];
+		if( s.d_kind == Slot::Atom )
+			qDebug() << QString("atom(0x%1)").arg( s.d_id, 0, 16 ) << " = " << s.d_value.toPrettyString();
+		else if( s.d_kind == Slot::Tag )
+			qDebug() << "tag(" << NameTag( s.d_id ).toString() << ") = " << s.d_value.toPrettyString();
+		else
+			qDebug() << s.d_name << " = " << s.d_value.toPrettyString();
+	}
 	qDebug( "*** BmlRecord end" );
 }
@@ -23,25 +23,153 @@
 #include <Stream/DataCell.h>
 #include <QList>
 #include <QMap>
+#include <QVector>
 
 namespace Stream
 {
 	class BmlRecord // Value
 	{
 	public:
-		BmlRecord() {}
+		// Ein benannter Slot. Alle Slots liegen in einem einzigen Array, sortiert nach d_kind,
+		// dann nach d_id (Atom und Tag) resp. d_name (String).
+		struct Slot
+		{
+			enum Kind { Atom, Tag, String };
+			quint8 d_kind;
+			quint32 d_id;
+			QByteArray d_name;
+			DataCell d_value;
+			Slot():d_kind(Atom),d_id(0) {}
+		};
+
+		// Kompatibilittsschicht fr Code, der die frheren QMap-Member verwendet. Referenzen
+		// auf Werte sind nur bis zur nchsten nderung des Records gltig.
+		template<class K, int Kind>
+		class MapView
+		{
+		public:
+			class const_iterator
+			{
+			public:
+				const_iterator( const Slot* s = 0 ):d_s(s) {}
+				K key() const { K k; _key( *d_s, k ); return k; }
+				const DataCell& value() const { return d_s->d_value; }
+				const DataCell& operator*() const { return d_s->d_value; }
+				const_iterator& operator++() { ++d_s; return *this; }
+				bool operator==( const const_iterator& rhs ) const { return d_s == rhs.d_s; }
+				bool operator!=( const const_iterator& rhs ) const { return d_s != rhs.d_s; }
+			private:
+				const Slot* d_s;
+			};
+			typedef const_iterator iterator;
+
+			MapView( BmlRecord* r ):d_rec(r) {}
+			int size() const { int a, b; d_rec->range( Kind, a, b ); return b - a; }
+			int count() const { return size(); }
+			bool isEmpty() const { return size() == 0; }
+			bool contains( const K& k ) const { return d_rec->find( Kind, _id(k), _name(k) ) != -1; }
+			const DataCell value( const K& k, const DataCell& def = DataCell() ) const
+			{
+				const int i = d_rec->find( Kind, _id(k), _name(k) );
+				return ( i == -1 )?def:d_rec->d_slots[i].d_value;
+			}
+			const DataCell operator[]( const K& k ) const { return value( k ); }
+			DataCell& operator[]( const K& k ) { return d_rec->insert( Kind, _id(k), _name(k) ); }
+			iterator insert( const K& k, const DataCell& v )
+			{
+				d_rec->insert( Kind, _id(k), _name(k) ) = v;
+				return find( k );
+			}
+			int remove( const K& k ) { return d_rec->remove( Kind, _id(k), _name(k) ); }
+			void clear() { d_rec->clearKind( Kind ); }
+			QList<K> keys() const
+			{
+				QList<K> res;
+				for( const_iterator i = begin(); i != end(); ++i )
+					res.append( i.key() );
+				return res;
+			}
+			QList<DataCell> values() const
+			{
+				QList<DataCell> res;
+				for( const_iterator i = begin(); i != end(); ++i )
+					res.append( i.value() );
+				return res;
+			}
+			const_iterator begin() const { int a, b; d_rec->range( Kind, a, b ); return d_rec->slotAt( a ); }
+			const_iterator end() const { int a, b; d_rec->range( Kind, a, b ); return d_rec->slotAt( b ); }
+			const_iterator constBegin() const { return begin(); }
+			const_iterator constEnd() const { return end(); }
+			const_iterator find( const K& k ) const
+			{
+				const int i = d_rec->find( Kind, _id(k), _name(k) );
+				return ( i == -1 )?end():d_rec->slotAt( i );
+			}
+			const_iterator constFind( const K& k ) const { return find( k ); }
+			QMap<K,DataCell> toMap() const
+			{
+				QMap<K,DataCell> res;
+				for( const_iterator i = begin(); i != end(); ++i )
+					res.insert( i.key(), i.value() );
+				return res;
+			}
+			operator QMap<K,DataCell>() const { return toMap(); }
+			MapView& operator=( const QMap<K,DataCell>& rhs )
+			{
+				clear();
+				typename QMap<K,DataCell>::const_iterator i;
+				for( i = rhs.begin(); i != rhs.end(); ++i )
+					d_rec->insert( Kind, _id(i.key()), _name(i.key()) ) = i.value();
+				return *this;
+			}
+		private:
+			MapView( const MapView& );
+			MapView& operator=( const MapView& );
+			BmlRecord* d_rec;
+		};
+
+		BmlRecord():d_atoms(this),d_tags(this),d_strings(this) {}
+		BmlRecord( const BmlRecord& );
 		BmlRecord( const QByteArray& );
 		BmlRecord( const DataCell& );
+		BmlRecord& operator=( const BmlRecord& );
 
 		void clear();
 		void readFrom( const QByteArray& bml );
 		void readFrom( const DataCell& bml );
 		void dump();
 
+		// Direkter Zugriff ohne Kopie; 0..nicht vorhanden
+		const DataCell* findAtom( quint32 ) const;
+		const DataCell* findTag( const NameTag& ) const;
+		const DataCell* findString( const QByteArray& ) const;
+		const QVector<Slot>& getSlots() const { return d_slots; }
+
 		QList<DataCell> d_array;
-		QMap<quint32,DataCell> d_atoms;
-		QMap<NameTag,DataCell> d_tags;
-		QMap<QByteArray,DataCell> d_strings;
+		MapView<quint32,Slot::Atom> d_atoms;
+		MapView<NameTag,Slot::Tag> d_tags;
+		MapView<QByteArray,Slot::String> d_strings;
+	private:
+		enum { LinearMax = 16 }; // Bis zu dieser Grsse wird linear gesucht
+		int lowerBound( quint8 kind, quint32 id, const QByteArray& name ) const;
+		int find( quint8 kind, quint32 id, const QByteArray& name ) const;
+		void range( quint8 kind, int& from, int& to ) const;
+		DataCell& insert( quint8 kind, quint32 id, const QByteArray& name );
+		int remove( quint8 kind, quint32 id, const QByteArray& name );
+		void clearKind( quint8 kind );
+		void append( quint8 kind, quint32 id, const QByteArray& name, const DataCell& );
+		void normalize();
+		const Slot* slotAt( int i ) const { return d_slots.constData() + i; }
+		static quint32 _id( quint32 k ) { return k; }
+		static quint32 _id( const NameTag& k ) { return k.d_id; }
+		static quint32 _id( const QByteArray& ) { return 0; }
+		static QByteArray _name( quint32 ) { return QByteArray(); }
+		static QByteArray _name( const NameTag& ) { return QByteArray(); }
+		static QByteArray _name( const QByteArray& k ) { return k; }
+		static void _key( const Slot& s, quint32& k ) { k = s.d_id; }
+		static void _key( const Slot& s, NameTag& k ) { k = NameTag( s.d_id ); }
+		static void _key( const Slot& s, QByteArray& k ) { k = s.d_name; }
+		QVector<Slot> d_slots;
 	};
 }
 
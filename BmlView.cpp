@@ -0,0 +1,544 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BmlView.h"
+#include "Helper.h"
+#include <Stream/Exceptions.h>
+#include <QVarLengthArray>
+using namespace Stream;
+
+BmlView::BmlView( const char* data, quint64 len )
+{
+	setData( data, len );
+}
+
+BmlView::BmlView( const QByteArray& in )
+{
+	setData( in.constData(), in.size() );
+}
+
+void BmlView::setNameTable( const NameTable& t )
+{
+	d_table = t;
+	seedNames();
+}
+
+void BmlView::seedNames()
+{
+	// Die Namen der Tabelle belegen die ersten Indizes
+	d_names.resize( d_table.size() );
+	for( int i = 0; i < d_table.size(); i++ )
+	{
+		const QByteArray& name = d_table.getName( i );
+		d_names[i] = Slice( name.constData(), name.size() );
+	}
+}
+
+void BmlView::setData( const char* data, quint64 len )
+{
+	d_data = data;
+	d_len = ( data )?len:0;
+	d_pos = 0;
+	d_value = Slice();
+	d_nameCell = Slice();
+	d_nameStr = Slice();
+	d_nameId = 0;
+	d_peek = DataCell::Peek();
+	seedNames();
+	d_ends.clear();
+	d_scopes.clear();
+	d_nameSym = DataCell::TypeNull;
+	d_lastToken = DataReader::Pending;
+	d_peeking = false;
+	d_level = 0;
+	d_body.clear();
+	d_outerData = 0;
+	d_outerLen = 0;
+	d_outerPos = 0;
+	d_packedNames = 0;
+	d_packedEnds = 0;
+	d_skipping = false;
+}
+
+static inline quint32 _clip( quint64 len )
+{
+	// Eine einzelne Zelle ist hchstens 4 GB lang
+	return ( len > 0xffffffff )?0xffffffff:len;
+}
+
+static bool _validCompression( const char* payload, quint32 len )
+{
+	// Wie von Codec::pack geschrieben: Lnge, ggf. Id des Codecs und mindestens ein Byte Stream;
+	// Codec und allenfalls dessen Wrterbuch mssen verfgbar sein
+	return len > 4 && Codec::canUnpack( payload, len );
+}
+
+BmlView::Validity BmlView::validate( const char* data, quint64 len, const NameTable* table, quint64* errorAt )
+{
+	struct Frame
+	{
+		quint64 d_end; // Position nach FrameEnd bzw. FramePacked oder 0 falls unbekannt
+		quint32 d_names; // Anzahl Namen nach dem Namen des Frames
+		bool d_scoped; // Die darin definierten Namen gelten nur im Frame
+	};
+	QVarLengthArray<Frame,64> frames;
+	quint32 names = ( table )?table->size():0;
+	quint64 pos = 0;
+	bool slotName = false; // Es wurde ein Slot-Name gelesen, es folgt der Wert
+	Validity res = Valid;
+	while( pos < len )
+	{
+		const char* p = data + pos;
+		const quint64 left = len - pos;
+		DataCell::Peek peek;
+		const DataCell::DecodeStatus s = DataCell::tryPeekCell( p, _clip( left ), peek );
+		if( s == DataCell::DecodePending )
+		{
+			res = Truncated;
+			break;
+		}else if( s != DataCell::DecodeOk )
+		{
+			res = InvalidCell;
+			break;
+		}
+		if( left < peek.getCellLength() )
+		{
+			res = Truncated;
+			break;
+		}
+		const DataCell::DataType type = peek.d_type;
+		const char* payload = p + peek.getHeaderLength();
+		const bool compressed = DataCell::symIsCompressed( p[0] );
+		if( slotName && type >= DataCell::MaxType && type != DataCell::LobChunked )
+		{
+			res = UnexpectedCell; // Nach einem Slot-Namen muss ein Wert folgen
+			break;
+		}
+		if( compressed && type != DataCell::FramePacked )
+		{
+			const int n = DataCell::typeByteCount[type];
+			if( n != DataCell::UNISTR && n != DataCell::CSTRING && n != DataCell::BINARY )
+			{
+				res = InvalidCell;
+				break;
+			}
+			if( !_validCompression( payload, peek.d_len ) )
+			{
+				res = InvalidCompression;
+				break;
+			}
+		}
+		switch( type )
+		{
+		case DataCell::FrameStart:
+		case DataCell::FrameStartSized:
+			{
+				Frame f;
+				f.d_end = 0;
+				f.d_scoped = false;
+				quint64 h = peek.getCellLength();
+				if( type == DataCell::FrameStartSized )
+				{
+					quint32 n;
+					Helper::read( payload, n );
+					if( n != 0 ) // 0..Lnge unbekannt
+					{
+						if( n > left - h )
+						{
+							res = InvalidFrameLength;
+							break;
+						}
+						f.d_end = pos + h + n;
+						f.d_scoped = true;
+					}
+				}
+				if( left > h && DataCell::isFrameNameSym( p[h] ) )
+				{
+					// Der Name des Frames wird als eigene Zelle im nchsten Durchgang gelesen
+					pos += h;
+					frames.append( f );
+					frames.last().d_names = quint32(-1); // wird nach dem Namen gesetzt
+					continue;
+				}
+				f.d_names = names;
+				frames.append( f );
+				pos += h;
+			}
+			continue;
+		case DataCell::FrameEnd:
+		case DataCell::FramePacked:
+			if( frames.isEmpty() )
+			{
+				res = UnbalancedFrame;
+				break;
+			}
+			if( type == DataCell::FramePacked && !_validCompression( payload, peek.d_len ) )
+			{
+				res = InvalidCompression;
+				break;
+			}
+			pos += peek.getCellLength();
+			if( frames.last().d_end != 0 && frames.last().d_end != pos )
+			{
+				pos -= peek.getCellLength();
+				res = InvalidFrameLength;
+				break;
+			}
+			// Namen aus einem Frame mit Lnge oder einem komprimierten Frame gelten nur darin
+			if( frames.last().d_scoped || type == DataCell::FramePacked )
+				names = frames.last().d_names;
+			frames.removeLast();
+			continue;
+		case DataCell::FrameName:
+		case DataCell::FrameNameStr:
+		case DataCell::FrameNameIdx:
+		case DataCell::FrameNameTag:
+		case DataCell::SlotName:
+		case DataCell::SlotNameStr:
+		case DataCell::SlotNameIdx:
+		case DataCell::SlotNameTag:
+			{
+				const bool frameName = type <= DataCell::FrameNameTag;
+				// Ein Frame-Name folgt nur direkt auf FrameStart, ein Slot-Name nie auf einen Namen
+				if( slotName || frameName != ( !frames.isEmpty() && frames.last().d_names == quint32(-1) ) )
+				{
+					res = UnexpectedCell;
+					break;
+				}
+				if( type == DataCell::FrameNameIdx || type == DataCell::SlotNameIdx )
+				{
+					quint32 i;
+					Helper::readMultibyte32( payload, i, peek.d_len );
+					if( i >= names )
+					{
+						res = InvalidNameIndex;
+						break;
+					}
+				}else if( type == DataCell::FrameNameStr || type == DataCell::SlotNameStr )
+					names++;
+				if( frameName )
+					frames.last().d_names = names;
+				else
+					slotName = true;
+				pos += peek.getCellLength();
+			}
+			continue;
+		default:
+			slotName = false;
+			pos += peek.getCellLength();
+			continue;
+		}
+		break; // Fehler
+	}
+	if( res == Valid && slotName )
+		res = Truncated;
+	else if( res == Valid && !frames.isEmpty() )
+		res = UnbalancedFrame;
+	if( errorAt )
+		*errorAt = pos;
+	return res;
+}
+
+int BmlView::readName( const char* data, quint64 len )
+{
+	const DataCell::Peek peek = DataCell::peekCell( data, _clip( len ) ); // throws
+	if( !peek.isValid() || len < peek.getCellLength() )
+		return -1;
+	d_nameSym = peek.d_type;
+	d_nameCell = Slice( data, peek.getCellLength() );
+	d_nameStr = Slice();
+	d_nameId = 0;
+	const char* payload = data + peek.getHeaderLength();
+	switch( peek.d_type )
+	{
+	case DataCell::FrameName:
+	case DataCell::SlotName:
+		Helper::read( payload, d_nameId );
+		break;
+	case DataCell::FrameNameTag:
+	case DataCell::SlotNameTag:
+		::memcpy( &d_nameId, payload, NameTag::Size );
+		break;
+	case DataCell::FrameNameStr:
+	case DataCell::SlotNameStr:
+		{
+			quint32 n = peek.d_len;
+			if( n > 0 && payload[n-1] == char(0) )
+				n--;
+			d_nameStr = Slice( payload, n ); // wird erst in fetchNext in d_names bernommen
+		}
+		break;
+	case DataCell::FrameNameIdx:
+	case DataCell::SlotNameIdx:
+		Helper::readMultibyte32( payload, d_nameId, peek.d_len );
+		if( d_nameId < quint32(d_names.size()) )
+			d_nameStr = d_names[d_nameId];
+		break;
+	default:
+		Q_ASSERT( false );
+	}
+	return peek.getCellLength();
+}
+
+void BmlView::fetchNext()
+{
+	d_lastToken = DataReader::Pending;
+	if( d_pos >= d_len )
+		return;
+
+	const char* p = d_data + d_pos;
+	const quint64 left = d_len - d_pos;
+	const DataCell::DataType type = DataCell::symToType( p[0] );
+
+	if( type == DataCell::FrameStart || type == DataCell::FrameStartSized )
+	{
+		quint32 h = 1;
+		quint64 end = 0;
+		bool sized = false;
+		if( type == DataCell::FrameStartSized )
+		{
+			if( left < 5 )
+				return; // Abgeschnittene Lnge
+			quint32 len;
+			Helper::read( p + 1, len );
+			h += 4;
+			sized = len != 0;
+			if( len != 0 && len <= d_len - d_pos - h ) // 0..Lnge unbekannt
+				end = d_pos + h + len;
+		}
+		int n = 0;
+		if( left > h && DataCell::isFrameNameSym( p[h] ) )
+		{
+			n = readName( p + h, left - h );
+			if( n < 0 )
+				return; // Abgeschnittener Name
+		}else
+		{
+			d_nameSym = DataCell::TypeNull;
+			d_nameStr = Slice();
+		}
+		if( d_nameSym == DataCell::FrameNameStr )
+			d_names.append( d_nameStr );
+		d_pos += h + n;
+		d_level++;
+		d_ends.append( end );
+		// Namen aus einem Frame mit Lnge gelten wie beim Writer nur darin
+		d_scopes.append( ( sized )?d_names.size():-1 );
+		d_lastToken = DataReader::BeginFrame;
+	}else if( type == DataCell::FrameEnd )
+	{
+		d_pos++;
+		endFrame();
+		if( d_outerData && d_ends.size() < d_packedEnds )
+			leavePacked(); // Ende des komprimierten Frames
+		d_lastToken = DataReader::EndFrame;
+	}else if( type == DataCell::FramePacked )
+	{
+		const DataCell::Peek peek = DataCell::peekCell( p, _clip( left ) ); // throws
+		if( !peek.isValid() || left < peek.getCellLength() )
+			return; // Abgeschnitten
+		d_pos += peek.getCellLength();
+		if( d_skipping )
+		{
+			// Der Rest des Frames inkl. FrameEnd wird bersprungen, ohne ihn zu entpacken
+			endFrame();
+			d_lastToken = DataReader::EndFrame;
+			return;
+		}
+		enterPacked( p + peek.getHeaderLength(), peek.d_len );
+		fetchNext();
+	}else
+	{
+		int n = 0;
+		if( DataCell::isSlotNameSym( p[0] ) )
+		{
+			n = readName( p, left );
+			if( n < 0 )
+				return;
+		}else
+		{
+			d_nameSym = DataCell::TypeNull;
+			d_nameStr = Slice();
+		}
+		const DataCell::Peek peek = DataCell::peekCell( p + n, _clip( left - n ) ); // throws
+		if( !peek.isValid() || left - n < peek.getCellLength() )
+			return; // Abgeschnittener Wert
+		if( d_nameSym == DataCell::SlotNameStr )
+			d_names.append( d_nameStr );
+		d_peek = peek;
+		d_value = Slice( p + n, peek.getCellLength() );
+		d_pos += n + peek.getCellLength();
+		d_lastToken = DataReader::Slot;
+	}
+}
+
+void BmlView::endFrame()
+{
+	d_level--;
+	if( !d_ends.isEmpty() )
+		d_ends.removeLast();
+	const int names = ( d_scopes.isEmpty() )?-1:d_scopes.takeLast();
+	if( names >= 0 && names < d_names.size() )
+		d_names.resize( names );
+}
+
+void BmlView::enterPacked( const char* payload, quint32 len )
+{
+	if( d_outerData )
+		throw StreamException( StreamException::InvalidProtocol, "nested packed frame" );
+	d_body = Codec::unpack( payload, len ); // throws
+	d_outerData = d_data;
+	d_outerLen = d_len;
+	d_outerPos = d_pos;
+	d_data = d_body.constData();
+	d_len = d_body.size();
+	d_pos = 0;
+	d_packedNames = d_names.size();
+	d_packedEnds = d_ends.size();
+}
+
+void BmlView::leavePacked()
+{
+	if( d_pos < d_len )
+		throw StreamException( StreamException::InvalidProtocol, "data after end of packed frame" );
+	d_data = d_outerData;
+	d_len = d_outerLen;
+	d_pos = d_outerPos;
+	d_outerData = 0;
+	// Die im komprimierten Frame definierten Namen gelten wie beim Writer nur darin
+	d_names.resize( d_packedNames );
+}
+
+BmlView::Token BmlView::nextToken( bool peek )
+{
+	// Gleiche Logik wie DataReader::nextToken
+	if( d_peeking )
+	{
+		if( !peek )
+			d_peeking = false;
+		return Token(d_lastToken);
+	}
+	if( peek )
+		d_peeking = true;
+	fetchNext();
+	return Token(d_lastToken);
+}
+
+bool BmlView::skipToEndFrame()
+{
+	if( !d_peeking && !d_ends.isEmpty() && d_ends.last() != 0 &&
+		( d_outerData == 0 || d_ends.size() > d_packedEnds ) &&
+		DataCell::symToType( d_data[ d_ends.last() - 1 ] ) == DataCell::FrameEnd )
+	{
+		// Frame mit Lngenangabe; direkt hinter das zugehrige EndFrame springen
+		d_pos = d_ends.last();
+		endFrame();
+		d_lastToken = DataReader::EndFrame;
+		return true;
+	}
+	const int startLevel = d_level;
+	d_skipping = true;
+	Token t = nextToken();
+	while( DataReader::isUseful( t ) )
+	{
+		if( t == DataReader::EndFrame && d_level < startLevel )
+		{
+			d_skipping = false;
+			return true;
+		}
+		t = nextToken();
+	}
+	d_skipping = false;
+	return false;
+}
+
+DataCell::DataType BmlView::getNameType() const
+{
+	switch( d_nameSym )
+	{
+	case DataCell::FrameName:
+	case DataCell::SlotName:
+		return DataCell::TypeAtom;
+	case DataCell::FrameNameTag:
+	case DataCell::SlotNameTag:
+		return DataCell::TypeTag;
+	case DataCell::FrameNameStr:
+	case DataCell::SlotNameStr:
+		return DataCell::TypeAscii;
+	case DataCell::FrameNameIdx:
+	case DataCell::SlotNameIdx:
+		return ( d_nameStr.isNull() )?DataCell::TypeId32:DataCell::TypeAscii;
+	default:
+		return DataCell::TypeNull;
+	}
+}
+
+NameTag BmlView::getNameTag() const
+{
+	if( d_nameSym != DataCell::FrameNameTag && d_nameSym != DataCell::SlotNameTag )
+		return NameTag::null;
+	return NameTag( d_nameId );
+}
+
+DataCell BmlView::getName() const
+{
+	DataCell res;
+	if( d_nameSym == DataCell::TypeNull )
+		res.setNull();
+	else if( ( d_nameSym == DataCell::FrameNameIdx || d_nameSym == DataCell::SlotNameIdx ) &&
+			 !d_nameStr.isNull() )
+		res.setLatin1( d_nameStr.toByteArray() ); // wie DataReader
+	else
+		res.readCell( d_nameCell.d_ptr, d_nameCell.d_len );
+	return res;
+}
+
+bool BmlView::isCompressed() const
+{
+	return !d_value.isNull() && DataCell::symIsCompressed( d_value.d_ptr[0] );
+}
+
+BmlView::Slice BmlView::getValueData() const
+{
+	if( d_value.isNull() || d_peek.d_type == DataCell::LobChunked )
+		return Slice(); // Die Stcke liegen nicht am Stck; readValue fgt sie zusammen
+	const char* payload = d_value.d_ptr + d_peek.getHeaderLength();
+	quint32 len = d_peek.d_len;
+	if( DataCell::typeByteCount[d_peek.d_type] == DataCell::CSTRING && !isCompressed() &&
+		len > 0 && payload[len-1] == char(0) )
+		len--;
+	return Slice( payload, len );
+}
+
+bool BmlView::readValue( DataCell& v ) const
+{
+	if( d_value.isNull() )
+	{
+		v.clear();
+		return false;
+	}
+	return v.readCell( d_value.d_ptr, d_value.d_len ) >= 0;
+}
+
+DataCell BmlView::readValue() const
+{
+	DataCell v;
+	readValue( v );
+	return v;
+}
@@ -0,0 +1,132 @@
+#ifndef __stream_bmlview__
+#define __stream_bmlview__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Stream/DataReader.h>
+#include <QVector>
+
+namespace Stream
+{
+	// Value Class
+	// Liest einen BML-Stream direkt ab einem zusammenhngenden Speicherbereich, ohne QIODevice.
+	// Strings, LOBs und BMLs werden nicht kopiert, sondern als Slice in den Quellspeicher
+	// zurckgegeben. Der Quellspeicher muss daher mindestens so lange leben wie der BmlView.
+	// Ausnahme sind komprimierte Frames (FramePacked): deren Inhalt wird beim Betreten in einen
+	// internen Puffer entpackt; Slices daraus gelten nur bis zum nchsten FramePacked.
+	class BmlView
+	{
+	public:
+		typedef DataReader::Token Token;
+
+		struct Slice
+		{
+			const char* d_ptr;
+			quint32 d_len;
+			Slice():d_ptr(0),d_len(0) {}
+			Slice( const char* p, quint32 l ):d_ptr(p),d_len(l) {}
+			bool isNull() const { return d_ptr == 0; }
+			QByteArray toRawData() const { return QByteArray::fromRawData( d_ptr, d_len ); } // ohne Kopie
+			QByteArray toByteArray() const { return QByteArray( d_ptr, d_len ); }
+		};
+
+		BmlView( const char* data = 0, quint64 len = 0 );
+		BmlView( const QByteArray& ); // Geliehen; der QByteArray muss weiterleben
+		void setData( const char* data, quint64 len );
+		// Dieselbe Tabelle wie beim Writer (siehe NameTable); gilt auch fr weitere setData.
+		// Vor dem ersten Token setzen.
+		void setNameTable( const NameTable& );
+
+		Token nextToken( bool peek = false );
+		Token getCurrentToken() const { return Token(d_lastToken); }
+		bool hasMoreData() const { return d_pos < d_len; }
+		qint16 getLevel() const { return d_level; }
+		quint64 getPos() const { return d_pos; }
+		bool skipToEndFrame(); // Bis und mit EndFrame; FrameStartSized ohne Tokenisierung, FramePacked ohne Entpacken
+
+		// Name des aktuellen Frames bzw. Slots
+		// TypeNull, TypeAtom, TypeTag, TypeAscii oder TypeId32 (Index ausserhalb der Stringtabelle)
+		DataCell::DataType getNameType() const;
+		DataCell::Atom getNameAtom() const { return ( d_nameSym == DataCell::FrameName ||
+			d_nameSym == DataCell::SlotName )?d_nameId:0; }
+		NameTag getNameTag() const;
+		Slice getNameStr() const { return d_nameStr; } // Ohne Nullzeichen
+		DataCell getName() const; // Wie DataReader::getName(); alloziiert bei String-Namen
+
+		// Wert des aktuellen Slots
+		DataCell::DataType getValueType() const { return d_peek.d_type; }
+		bool isCompressed() const;
+		// Nutzdaten ohne Typ und Lnge; bei CSTRING ohne Nullzeichen. Ist die Zelle komprimiert,
+		// werden die komprimierten Bytes geliefert; bei LobChunked leer.
+		Slice getValueData() const;
+		Slice getValueCell() const { return d_value; } // Ganze Zelle mit Typ und Lnge
+		bool readValue( DataCell& ) const; // Dekodiert den Wert; true..ok
+		DataCell readValue() const;
+
+		// Prft die Struktur eines ganzen BML in einem linearen Durchgang, ohne Werte zu dekodieren
+		// oder komprimierte Daten zu entpacken: Typsymbole und Lngen, FrameStart/FrameEnd, Lngen
+		// von FrameStartSized, Namensindizes (names..dieselbe Tabelle wie beim Writer oder 0)
+		// sowie die Header komprimierter Zellen und Frames (Codec verfgbar). Der Inhalt eines
+		// FramePacked wird nicht geprft. Alloziert erst ab 64 verschachtelten Frames.
+		// errorAt..Offset der fehlerhaften Zelle ab data
+		enum Validity { Valid, Truncated, InvalidCell, UnexpectedCell, UnbalancedFrame,
+						InvalidFrameLength, InvalidNameIndex, InvalidCompression };
+		static Validity validate( const char* data, quint64 len, const NameTable* names = 0,
+								  quint64* errorAt = 0 );
+		static Validity validate( const QByteArray& data, const NameTable* names = 0, quint64* errorAt = 0 )
+			{ return validate( data.constData(), data.size(), names, errorAt ); }
+	private:
+		void fetchNext();
+		int readName( const char* data, quint64 len );
+		void endFrame();
+		void enterPacked( const char* payload, quint32 len );
+		void leavePacked();
+		void seedNames();
+		const char* d_data;
+		quint64 d_len;
+		quint64 d_pos;
+		Slice d_value;
+		Slice d_nameCell;
+		Slice d_nameStr;
+		quint32 d_nameId; // Atom, Tag oder Index
+		DataCell::Peek d_peek;
+		QVector<Slice> d_names; // Zeigen in d_data oder d_table
+		NameTable d_table;
+		QList<quint64> d_ends; // Pro offenem Frame Position nach EndFrame oder 0 falls unbekannt
+		QList<int> d_scopes; // Pro offenem Frame Anzahl d_names nach dessen Namen oder -1
+		// Beim Lesen eines FramePacked zeigen d_data, d_len und d_pos in d_body
+		QByteArray d_body;
+		const char* d_outerData;
+		quint64 d_outerLen;
+		quint64 d_outerPos;
+		int d_packedNames;
+		int d_packedEnds;
+		bool d_skipping;
+		quint8 d_nameSym; // DataCell::DataType des Namens oder TypeNull
+		quint8 d_lastToken;
+		bool d_peeking;
+		qint16 d_level;
+	};
+
+	// Wie tagOf in NameTag.h, mit dem Namen des aktuellen Tokens, ohne DataCell
+	inline quint32 tagOf( const BmlView& view ) { return view.getNameTag().d_id; }
+}
+
+#endif // __stream_bmlview__
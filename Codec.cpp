@@ -0,0 +1,512 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Codec.h"
+#include <Stream/Exceptions.h>
+#include <zlib/zlib.h>
+#include <QMap>
+#include <QIODevice>
+#ifdef STREAM_USE_ZSTD
+#include <zstd.h>
+#include <QThreadStorage>
+#endif
+#ifdef STREAM_USE_LZ4
+#include <lz4.h>
+#endif
+using namespace Stream;
+
+// Grsse der Stcke, die beim Entpacken von einem Gert gelesen werden
+static const quint32 s_chunk = 0x10000;
+
+static void _skip( QIODevice* in, quint32& left )
+{
+	// Der Rest der Zelle wird berlesen, damit das Gert hinter der Zelle steht
+	while( left > 0 )
+	{
+		const QByteArray chunk = in->read( qMin( left, s_chunk ) );
+		if( chunk.isEmpty() )
+			break;
+		left -= chunk.size();
+	}
+}
+
+static QByteArray _inflate(const uchar* data, int nbytes, ulong expectedSize, QIODevice* in = 0, quint32 left = 0 )
+{
+	// Entpackt in einem Durchgang direkt in einen Puffer mit der Lnge aus dem Header. Die
+	// Eingabe besteht aus data und, falls in gesetzt, weiteren left Bytes vom Gert, die
+	// stckweise gelesen werden. Ist der Header zu klein, wird der Puffer vergrssert, ohne
+	// von vorne zu beginnen.
+	z_stream zs;
+	::memset( &zs, 0, sizeof(zs) );
+	if( ::inflateInit( &zs ) != Z_OK )
+	{
+		qWarning("qUncompress: Z_MEM_ERROR: Not enough memory");
+		_skip( in, left );
+		return QByteArray();
+	}
+	// deflate expandiert hchstens um Faktor 1032; ein defekter Header soll nicht zu einer
+	// riesigen Allokation fhren.
+	const quint64 bound = qMin( ( quint64(nbytes) + left ) * 1032 + 1, quint64(0x7fffffff) );
+	QByteArray baunzip( int( qMin( quint64( qMax( expectedSize, 1ul ) ), bound ) ), 0 );
+	QByteArray chunk;
+	zs.next_in = (Bytef*)data;
+	zs.avail_in = nbytes;
+	int res = Z_OK;
+	while( res == Z_OK )
+	{
+		if( zs.avail_in == 0 && left > 0 )
+		{
+			chunk = in->read( qMin( left, s_chunk ) );
+			if( chunk.isEmpty() )
+				break; // Das Gert liefert weniger als angegeben
+			left -= chunk.size();
+			zs.next_in = (Bytef*)chunk.data();
+			zs.avail_in = chunk.size();
+		}
+		if( zs.total_out == ulong(baunzip.size()) )
+			baunzip.resize( baunzip.size() + qMax( baunzip.size() / 2, int(s_chunk) ) );
+		zs.next_out = (Bytef*)baunzip.data() + zs.total_out;
+		zs.avail_out = baunzip.size() - zs.total_out;
+		res = ::inflate( &zs, Z_NO_FLUSH );
+		if( res == Z_BUF_ERROR && ( zs.avail_out == 0 || ( zs.avail_in == 0 && left > 0 ) ) )
+			res = Z_OK; // Es fehlt nur Platz oder das nchste Stck
+	}
+	const ulong len = zs.total_out;
+	::inflateEnd( &zs );
+	_skip( in, left );
+
+	switch (res) {
+	case Z_STREAM_END:
+		baunzip.resize(len);
+		return baunzip;
+	case Z_MEM_ERROR:
+		qWarning("qUncompress: Z_MEM_ERROR: Not enough memory");
+		break;
+	default:
+		qWarning("qUncompress: Z_DATA_ERROR: Input data is corrupted");
+		break;
+	}
+	return QByteArray();
+}
+
+static QByteArray myUncompress(const uchar* data, int nbytes)
+{
+	// Direkte Kopie aus Qt-4.3.5. Diese Routine ist ab Qt 4.4 fehlerhaft
+    if (!data) {
+        qWarning("qUncompress: Data is null");
+        return QByteArray();
+    }
+    if (nbytes <= 4) {
+        if (nbytes < 4 || (data[0]!=0 || data[1]!=0 || data[2]!=0 || data[3]!=0))
+            qWarning("qUncompress: Input data is corrupted");
+        return QByteArray();
+    }
+    ulong expectedSize = (data[0] << 24) | (data[1] << 16) |
+                       (data[2] <<  8) | (data[3]);
+	/* NOTE: Qt setzt in qCompress die Originallnge als 32Bit-Zahl vor den Stream in folgender Weise, die plattformunabhngig ist:
+	        bazip.resize(len + 4);
+            bazip[0] = (nbytes & 0xff000000) >> 24;
+            bazip[1] = (nbytes & 0x00ff0000) >> 16;
+            bazip[2] = (nbytes & 0x0000ff00) >> 8;
+            bazip[3] = (nbytes & 0x000000ff);
+	*/
+    return _inflate(data+4, nbytes-4, expectedSize);
+}
+
+class ZlibCodec : public Codec
+{
+public:
+	quint8 getId() const { return Zlib; }
+	const char* getName() const { return "zlib"; }
+	QByteArray compress( const char* data, quint32 len ) const
+	{
+		// Entspricht qCompress mit Level 7, aber ohne dessen Lngen-Header
+		uLongf n = ::compressBound( len );
+		QByteArray res( int(n), 0 );
+		if( ::compress2( (Bytef*)res.data(), &n, (const Bytef*)data, len, 7 ) != Z_OK ) // RISK. -1 entspricht 6
+			return QByteArray();
+		res.resize( int(n) );
+		return res;
+	}
+	QByteArray uncompress( const char* data, quint32 len, quint32 raw ) const
+	{
+		return _inflate( reinterpret_cast<const uchar*>(data), len, raw );
+	}
+	QByteArray uncompressFrom( QIODevice* in, quint32 len, quint32 raw ) const
+	{
+		return _inflate( 0, 0, raw, in, len );
+	}
+};
+
+#ifdef STREAM_USE_ZSTD
+static bool _zstdBound( const char* head, quint32 headLen, quint32 len, quint32 raw )
+{
+	// Wie bei deflate soll ein defekter Header nicht zu einer riesigen Allokation fhren. Steht
+	// die Lnge im Frame-Header, muss sie passen; sonst braucht jeder Block von hchstens 128 KB
+	// (ZSTD_BLOCKSIZE_MAX) mindestens 4 der len Bytes (Header und ein RLE-Byte).
+	const unsigned long long size = ::ZSTD_getFrameContentSize( head, headLen );
+	if( size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR )
+		return size == raw;
+	return quint64(raw) <= ( quint64(len) / 4 + 1 ) * 0x20000;
+}
+
+class ZstdCodec : public Codec
+{
+public:
+	enum { Level = 3 };
+	~ZstdCodec()
+	{
+		QMap<quint32,Dict>::const_iterator i;
+		for( i = d_dicts.begin(); i != d_dicts.end(); ++i )
+		{
+			::ZSTD_freeCDict( i.value().d_comp );
+			::ZSTD_freeDDict( i.value().d_decomp );
+		}
+	}
+	quint8 getId() const { return Zstd; }
+	const char* getName() const { return "zstd"; }
+	QByteArray compress( const char* data, quint32 len ) const
+	{
+		ZSTD_CCtx* ctx = compressor();
+		QByteArray res( int( ::ZSTD_compressBound( len ) ), 0 );
+		const size_t n = ::ZSTD_compressCCtx( ctx, res.data(), res.size(), data, len, Level );
+		if( ::ZSTD_isError( n ) )
+			return QByteArray();
+		res.resize( int(n) );
+		return res;
+	}
+	QByteArray compressWith( const char* data, quint32 len, quint32 dict ) const
+	{
+		if( !d_dicts.contains( dict ) )
+			return compress( data, len );
+		// Die Id des Wrterbuchs steht im Frame-Header. Die Lnge steht schon in unserem
+		// Header; bei kurzen Werten zhlt jedes Byte.
+		ZSTD_CCtx* ctx = compressor();
+		::ZSTD_CCtx_refCDict( ctx, d_dicts.value( dict ).d_comp );
+		::ZSTD_CCtx_setParameter( ctx, ZSTD_c_contentSizeFlag, 0 );
+		QByteArray res( int( ::ZSTD_compressBound( len ) ), 0 );
+		const size_t n = ::ZSTD_compress2( ctx, res.data(), res.size(), data, len );
+		if( ::ZSTD_isError( n ) )
+			return QByteArray();
+		res.resize( int(n) );
+		return res;
+	}
+	QByteArray uncompress( const char* data, quint32 len, quint32 raw ) const
+	{
+		if( !_zstdBound( data, len, len, raw ) )
+		{
+			qWarning( "Codec: zstd data is corrupted" );
+			return QByteArray();
+		}
+		const quint32 dict = ::ZSTD_getDictID_fromFrame( data, len );
+		QByteArray res( int(raw), 0 );
+		size_t n;
+		if( dict != 0 )
+		{
+			if( !d_dicts.contains( dict ) )
+				throw StreamException( StreamException::WrongDataFormat,
+									   QString( "Codec: zstd dictionary %1 not registered" ).arg( dict ) );
+			n = ::ZSTD_decompress_usingDDict( decompressor(), res.data(), raw, data, len,
+											  d_dicts.value( dict ).d_decomp );
+		}else
+			n = ::ZSTD_decompressDCtx( decompressor(), res.data(), raw, data, len );
+		if( ::ZSTD_isError( n ) || n != raw )
+		{
+			qWarning( "Codec: zstd data is corrupted" );
+			return QByteArray();
+		}
+		return res;
+	}
+	QByteArray uncompressFrom( QIODevice* in, quint32 len, quint32 raw ) const
+	{
+		// Der Frame-Header mit der Id des Wrterbuchs ist hchstens 18 Bytes lang und steht
+		// darum im ersten Stck.
+		QByteArray chunk = in->read( qMin( len, s_chunk ) );
+		quint32 left = len - chunk.size();
+		const quint32 dict = ::ZSTD_getDictID_fromFrame( chunk.constData(), chunk.size() );
+		if( dict != 0 && !d_dicts.contains( dict ) )
+			throw StreamException( StreamException::WrongDataFormat,
+								   QString( "Codec: zstd dictionary %1 not registered" ).arg( dict ) );
+		if( !_zstdBound( chunk.constData(), chunk.size(), len, raw ) )
+		{
+			_skip( in, left );
+			qWarning( "Codec: zstd data is corrupted" );
+			return QByteArray();
+		}
+		ZSTD_DCtx* ctx = decompressor();
+		if( dict != 0 )
+			::ZSTD_DCtx_refDDict( ctx, d_dicts.value( dict ).d_decomp );
+		QByteArray res( int(raw), 0 );
+		ZSTD_outBuffer out = { res.data(), raw, 0 };
+		size_t n = 1; // 0..Frame vollstndig
+		bool ok = true;
+		while( ok && !chunk.isEmpty() )
+		{
+			ZSTD_inBuffer src = { chunk.constData(), size_t(chunk.size()), 0 };
+			while( ok && src.pos < src.size )
+			{
+				const size_t done = src.pos + out.pos;
+				n = ::ZSTD_decompressStream( ctx, &out, &src );
+				ok = !::ZSTD_isError( n ) && src.pos + out.pos != done; // sonst lnger als raw
+			}
+			chunk = in->read( qMin( left, s_chunk ) );
+			left -= chunk.size();
+		}
+		_skip( in, left );
+		if( !ok || n != 0 || out.pos != raw )
+		{
+			qWarning( "Codec: zstd data is corrupted" );
+			return QByteArray();
+		}
+		return res;
+	}
+	bool canUncompress( const char* data, quint32 len ) const
+	{
+		const quint32 dict = ::ZSTD_getDictID_fromFrame( data, len );
+		return dict == 0 || d_dicts.contains( dict );
+	}
+	quint32 addDictionary( const QByteArray& dict )
+	{
+		const quint32 id = ::ZSTD_getDictID_fromDict( dict.constData(), dict.size() );
+		if( id == 0 || d_dicts.contains( id ) )
+			return id; // 0..kein trainiertes Wrterbuch
+		Dict d;
+		d.d_comp = ::ZSTD_createCDict( dict.constData(), dict.size(), Level );
+		d.d_decomp = ::ZSTD_createDDict( dict.constData(), dict.size() );
+		d_dicts[id] = d;
+		return id;
+	}
+	bool hasDictionary( quint32 id ) const { return d_dicts.contains( id ); }
+private:
+	struct Dict
+	{
+		ZSTD_CDict* d_comp;
+		ZSTD_DDict* d_decomp;
+	};
+	// Bei kurzen Zellen kostet das Anlegen der Kontexte mehr als die Kompression selbst. Sie
+	// werden darum pro Thread einmal angelegt und vor jeder Verwendung zurckgesetzt.
+	struct Contexts
+	{
+		ZSTD_CCtx* d_comp;
+		ZSTD_DCtx* d_decomp;
+		Contexts():d_comp( ::ZSTD_createCCtx() ),d_decomp( ::ZSTD_createDCtx() ) {}
+		~Contexts()
+		{
+			::ZSTD_freeCCtx( d_comp );
+			::ZSTD_freeDCtx( d_decomp );
+		}
+	};
+	Contexts* contexts() const
+	{
+		if( !d_contexts.hasLocalData() )
+			d_contexts.setLocalData( new Contexts() );
+		return d_contexts.localData();
+	}
+	ZSTD_CCtx* compressor() const
+	{
+		ZSTD_CCtx* ctx = contexts()->d_comp;
+		::ZSTD_CCtx_reset( ctx, ZSTD_reset_session_and_parameters );
+		return ctx;
+	}
+	ZSTD_DCtx* decompressor() const
+	{
+		ZSTD_DCtx* ctx = contexts()->d_decomp;
+		::ZSTD_DCtx_reset( ctx, ZSTD_reset_session_and_parameters );
+		return ctx;
+	}
+	QMap<quint32,Dict> d_dicts;
+	mutable QThreadStorage<Contexts*> d_contexts;
+};
+#endif
+
+#ifdef STREAM_USE_LZ4
+class Lz4Codec : public Codec
+{
+public:
+	quint8 getId() const { return Lz4; }
+	const char* getName() const { return "lz4"; }
+	QByteArray compress( const char* data, quint32 len ) const
+	{
+		QByteArray res( ::LZ4_compressBound( len ), 0 );
+		const int n = ::LZ4_compress_default( data, res.data(), len, res.size() );
+		if( n <= 0 )
+			return QByteArray();
+		res.resize( n );
+		return res;
+	}
+	QByteArray uncompress( const char* data, quint32 len, quint32 raw ) const
+	{
+		// LZ4 expandiert hchstens um Faktor 255; ein defekter Header soll nicht zu einer
+		// riesigen Allokation fhren.
+		if( raw > LZ4_MAX_INPUT_SIZE || len > quint32( LZ4_COMPRESSBOUND( raw ) ) ||
+			quint64(raw) > quint64(len) * 255 )
+		{
+			qWarning( "Codec: lz4 data is corrupted" );
+			return QByteArray();
+		}
+		QByteArray res( int(raw), 0 );
+		const int n = ::LZ4_decompress_safe( data, res.data(), len, raw );
+		if( n < 0 || quint32(n) != raw )
+		{
+			qWarning( "Codec: lz4 data is corrupted" );
+			return QByteArray();
+		}
+		return res;
+	}
+};
+#endif
+
+static Codec* s_codecs[256] = { 0 };
+
+static void _registerBuiltins()
+{
+	static bool done = false;
+	if( done )
+		return;
+	done = true;
+	static ZlibCodec zlib;
+	s_codecs[zlib.getId()] = &zlib;
+#ifdef STREAM_USE_ZSTD
+	static ZstdCodec zstd;
+	s_codecs[zstd.getId()] = &zstd;
+#endif
+#ifdef STREAM_USE_LZ4
+	static Lz4Codec lz4;
+	s_codecs[lz4.getId()] = &lz4;
+#endif
+}
+
+void Codec::registerCodec( Codec* c )
+{
+	Q_ASSERT( c != 0 );
+	if( c->getId() != Zlib && ( c->getId() & 0x0f ) != 0x0f )
+		throw StreamException( StreamException::IncompleteImplementation,
+							   "Codec: id must have 0xf in the low nibble" );
+	_registerBuiltins();
+	s_codecs[c->getId()] = c;
+}
+
+const Codec* Codec::getCodec( quint8 id )
+{
+	_registerBuiltins();
+	return s_codecs[id];
+}
+
+quint32 Codec::registerDictionary( quint8 codec, const QByteArray& dict )
+{
+	_registerBuiltins();
+	Codec* c = s_codecs[codec];
+	if( c == 0 )
+		return 0;
+	return c->addDictionary( dict );
+}
+
+bool Codec::hasDictionary( quint8 codec, quint32 id )
+{
+	const Codec* c = getCodec( codec );
+	return c != 0 && id != 0 && c->hasDictionary( id );
+}
+
+quint8 Codec::peekId( const char* payload, quint32 len )
+{
+	if( len > 4 && ( quint8(payload[4]) & 0x0f ) == 0x0f )
+		return payload[4];
+	else
+		return Zlib;
+}
+
+QByteArray Codec::pack( quint8 id, const char* data, quint32 len, quint32 dict )
+{
+	const Codec* c = getCodec( id );
+	if( c == 0 )
+		return QByteArray();
+	const QByteArray body = ( dict != 0 )?c->compressWith( data, len, dict ):c->compress( data, len );
+	if( body.isEmpty() )
+		return QByteArray();
+	QByteArray res;
+	res.reserve( 5 + body.size() );
+	res.append( char( ( len & 0xff000000 ) >> 24 ) );
+	res.append( char( ( len & 0x00ff0000 ) >> 16 ) );
+	res.append( char( ( len & 0x0000ff00 ) >> 8 ) );
+	res.append( char( len & 0x000000ff ) );
+	if( id != Zlib )
+		res.append( char( id ) );
+	res.append( body );
+	return res;
+}
+
+bool Codec::canUnpack( const char* payload, quint32 len )
+{
+	if( len <= 4 )
+		return true; // wie unpack
+	const quint8 id = peekId( payload, len );
+	const Codec* c = getCodec( id );
+	if( c == 0 )
+		return false;
+	const int off = ( id == Zlib )?4:5;
+	return c->canUncompress( payload + off, len - off );
+}
+
+QByteArray Codec::uncompressFrom( QIODevice* in, quint32 len, quint32 raw ) const
+{
+	// Codecs ohne Stream-Schnittstelle (z.B. LZ4 im Block-Format) brauchen den ganzen Stream
+	const QByteArray data = in->read( len );
+	if( quint32(data.size()) != len )
+	{
+		qWarning( "Codec: %s data is truncated", getName() );
+		return QByteArray();
+	}
+	return uncompress( data.constData(), len, raw );
+}
+
+QByteArray Codec::unpack( const char* payload, quint32 len )
+{
+	if( len <= 4 )
+		return myUncompress( reinterpret_cast<const uchar*>(payload), len ); // gleiche Warnungen wie bisher
+	const quint8 id = peekId( payload, len );
+	const Codec* c = getCodec( id );
+	if( c == 0 )
+		throw StreamException( StreamException::WrongDataFormat,
+							   QString( "Codec: codec 0x%1 not available" ).arg( id, 0, 16 ) );
+	const uchar* p = reinterpret_cast<const uchar*>(payload);
+	const quint32 raw = ( p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+	const int off = ( id == Zlib )?4:5;
+	return c->uncompress( payload + off, len - off, raw );
+}
+
+QByteArray Codec::unpack( QIODevice* in, quint32 len )
+{
+	char head[5];
+	if( len <= sizeof(head) || in->peek( head, sizeof(head) ) != sizeof(head) )
+	{
+		const QByteArray payload = in->read( len );
+		return unpack( payload.constData(), payload.size() );
+	}
+	const quint8 id = peekId( head, sizeof(head) );
+	const Codec* c = getCodec( id );
+	if( c == 0 )
+		throw StreamException( StreamException::WrongDataFormat,
+							   QString( "Codec: codec 0x%1 not available" ).arg( id, 0, 16 ) );
+	// Bei zlib gehrt das fnfte Byte bereits zum Stream
+	const quint32 off = ( id == Zlib )?4:5;
+	in->read( head, off );
+	const uchar* p = reinterpret_cast<const uchar*>(head);
+	const quint32 raw = ( p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+	return c->uncompressFrom( in, len - off, raw );
+}
@@ -0,0 +1,81 @@
+#ifndef __stream_codec__
+#define __stream_codec__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QByteArray>
+
+class QIODevice;
+
+namespace Stream
+{
+	// Kompressionsverfahren fr komprimierte Zellen (Symbol mit gesetztem MSB). Die Nutzdaten
+	// beginnen wie bei qCompress mit der unkomprimierten Lnge als 32-Bit-Zahl (Big Endian).
+	// Bei zlib folgt direkt der zlib-Stream; dessen erstes Byte (CMF) hat im unteren Nibble
+	// immer 8. Andere Codecs schreiben nach der Lnge ihre Id, deren unteres Nibble 0xf ist
+	// (in zlib reserviert), und danach ihren Stream. Alte Daten bleiben so lesbar.
+	class Codec
+	{
+	public:
+		enum Id { Zlib = 0x08, Zstd = 0x1f, Lz4 = 0x2f };
+
+		virtual ~Codec() {}
+		virtual quint8 getId() const = 0;
+		virtual const char* getName() const = 0;
+		// Resultat ohne Header; leer..Fehler
+		virtual QByteArray compress( const char* data, quint32 len ) const = 0;
+		// raw..unkomprimierte Lnge gemss Header; leer..Fehler
+		virtual QByteArray uncompress( const char* data, quint32 len, quint32 raw ) const = 0;
+		// Wie uncompress, liest aber genau len Bytes stckweise vom Gert. Die Default-
+		// Implementation liest den ganzen Stream und ruft uncompress auf.
+		virtual QByteArray uncompressFrom( QIODevice* in, quint32 len, quint32 raw ) const;
+		// false..uncompress wrde werfen, z.B. weil das Wrterbuch des Streams fehlt
+		virtual bool canUncompress( const char*, quint32 ) const { return true; }
+		// Wrterbcher fr kleine Zellen; die Default-Implementationen untersttzen keine.
+		// Der Codec muss das Wrterbuch beim Dekomprimieren selber aus seinem Stream erkennen.
+		virtual quint32 addDictionary( const QByteArray& ) { return 0; } // returns Id oder 0
+		virtual bool hasDictionary( quint32 ) const { return false; }
+		virtual QByteArray compressWith( const char* data, quint32 len, quint32 ) const
+			{ return compress( data, len ); }
+
+		// Die Registry bernimmt kein Ownership. Codecs sollen vor dem ersten Lesen oder
+		// Schreiben registriert werden; die Registry ist nicht synchronisiert.
+		static void registerCodec( Codec* );
+		static const Codec* getCodec( quint8 id ); // 0..nicht verfgbar
+		static bool isAvailable( quint8 id ) { return getCodec( id ) != 0; }
+		// Registriert ein trainiertes Wrterbuch (z.B. von BmlDictTrainer) fr Writer und Reader.
+		// returns die im Wrterbuch enthaltene Id oder 0, falls der Codec es nicht untersttzt.
+		static quint32 registerDictionary( quint8 codec, const QByteArray& dict );
+		static bool hasDictionary( quint8 codec, quint32 id );
+
+		// Nutzdaten einer komprimierten Zelle inkl. Header; leer..Codec fehlt oder Fehler
+		// dict..Id eines registrierten Wrterbuchs oder 0
+		static QByteArray pack( quint8 id, const char* data, quint32 len, quint32 dict = 0 );
+		// Ermittelt den Codec aus dem Header; throws falls der Codec nicht verfgbar ist
+		static QByteArray unpack( const char* payload, quint32 len );
+		// Liest die len Bytes der Nutzdaten vom Gert, ohne sie vorher ganz zu kopieren
+		static QByteArray unpack( QIODevice* in, quint32 len );
+		static quint8 peekId( const char* payload, quint32 len );
+		// false..unpack wrde werfen, weil der Codec oder dessen Wrterbuch nicht verfgbar ist
+		static bool canUnpack( const char* payload, quint32 len );
+	};
+}
+
+#endif // __stream_codec__
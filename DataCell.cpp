@@ -19,6 +19,7 @@
 
 #include "DataCell.h"
 #include "Helper.h"
+#include "IoPolicy.h"
 #include <Stream/Exceptions.h>
 #include <QBuffer>
 #include <QDataStream>
@@ -71,6 +72,7 @@ static const quint8 s_symLob = 60;
 static const quint8 s_symImg = 64;
 static const quint8 s_symPic = 65;
 static const quint8 s_symBml = 66;
+static const quint8 s_symLobChunked = 67;
 static const quint8 s_symFrameStart = 110;
 static const quint8 s_symFrameName = 111;
 static const quint8 s_symFrameEnd = 112;
@@ -81,213 +83,25 @@ static const quint8 s_symFrameNameTag = 116;
 static const quint8 s_symSlotNameTag = 117;
 static const quint8 s_symFrameNameIdx = 118;
 static const quint8 s_symSlotNameIdx = 119;
+static const quint8 s_symFrameStartSized = 120;
+static const quint8 s_symFramePacked = 121;
 static const quint8 s_symInvalid = 0x7f; // 127
 
 const char* DataCell::bmlMimeType = "application/x-bml";
 static const quint32 s_compressionThreshold = 127;
+static const quint32 s_dictThreshold = 16; // Mit Wrterbuch lohnen sich auch kurze Werte
 
 bool DataCell::symIsCompressed( quint8 sym )
 {
 	return ( sym & 0x80 ) != 0;
 }
 
-DataCell::DataType DataCell::symToType( quint8 sym )
-{
-	switch( sym & 0x7f ) // nur die ersten 7 Bit verwendet. Achtes Bit ist Kompressionsflag
-	{
-	case s_symNull:
-		return TypeNull;
-	case s_symTrue:
-		return TypeTrue;
-	case s_symFalse:
-		return TypeFalse;
-	case s_symInt32:
-		return TypeInt32;
-	case s_symUInt32:
-		return TypeUInt32;
-	case s_symInt64:
-		return TypeInt64;
-	case s_symUInt64:
-		return TypeUInt64;
-	case s_symDouble:
-		return TypeDouble;
-    case s_symFloat:
-		return TypeFloat;
-	case s_symDate:
-		return TypeDate;
-	case s_symTime:
-		return TypeTime;
-	case s_symDateTimeOld:
-    case s_symDateTimeNew:
-		return TypeDateTime;
-	case s_symTimeSlot:
-		return TypeTimeSlot;
-	case s_symTag:
-		return TypeTag;
-	case s_symUrl:
-		return TypeUrl;
-	case s_symUInt8:
-		return TypeUInt8;
-	case s_symUInt16:
-		return TypeUInt16;
-	case s_symAtom:
-		return TypeAtom;
-	case s_symOid64:
-		return TypeOid;
-	case s_symRid:
-		return TypeRid;
-	case s_symSid:
-		return TypeSid;
-	case s_symId32:
-		return TypeId32;
-	case s_symId64:
-		return TypeId64;
-	case s_symLatin1:
-		return TypeLatin1;
-	case s_symAscii:
-		return TypeAscii;
-	case s_symString:
-		return TypeString;
-	case s_symHtml:
-		return TypeHtml;
-	case s_symXml:
-		return TypeXml;
-	case s_symLob:
-		return TypeLob;
-	case s_symBml:
-		return TypeBml;
-	case s_symFrameStart:
-		return FrameStart;
-	case s_symFrameName:
-		return FrameName;
-	case s_symFrameNameTag:
-		return FrameNameTag;
-	case s_symFrameNameStr:
-		return FrameNameStr;
-	case s_symFrameNameIdx:
-		return FrameNameIdx;
-	case s_symFrameEnd:
-		return FrameEnd;
-	case s_symSlotName:
-		return SlotName;
-	case s_symSlotNameStr:
-		return SlotNameStr;
-	case s_symSlotNameIdx:
-		return SlotNameIdx;
-	case s_symSlotNameTag:
-		return SlotNameTag;
-	case s_symImg:
-		return TypeImg;
-	case s_symPic:
-		return TypePic;
-	case s_symUuid:
-		return TypeUuid;
-	}
-	return TypeInvalid;
-}
-
-quint8 DataCell::typeToSym( DataType t )
-{
-	switch( t )
-	{
-	case TypeNull:
-		return s_symNull;
-	case TypeTrue:
-		return s_symTrue;
-	case TypeFalse:
-		return s_symFalse;
-	case TypeInt32:
-		return s_symInt32;
-	case TypeUInt32:
-		return s_symUInt32;
-	case TypeInt64:
-		return s_symInt64;
-	case TypeUInt64:
-		return s_symUInt64;
-	case TypeDouble:
-		return s_symDouble;
-    case TypeFloat:
-		return s_symFloat;
-	case TypeDate:
-		return s_symDate;
-	case TypeTime:
-		return s_symTime;
-	case TypeDateTime:
-		return s_symDateTimeNew;
-	case TypeTimeSlot:
-		return s_symTimeSlot;
-	case TypeTag:
-		return s_symTag;
-	case TypeUInt8:
-		return s_symUInt8;
-	case TypeUInt16:
-		return s_symUInt16;
-	case TypeAtom:
-		return s_symAtom;
-	case TypeOid:
-		return s_symOid64;
-	case TypeRid:
-		return s_symRid;
-	case TypeSid:
-		return s_symSid;
-	case TypeId32:
-		return s_symId32;
-	case TypeId64:
-		return s_symId64;
-	case TypeLatin1:
-		return s_symLatin1;
-	case TypeAscii:
-		return s_symAscii;
-	case TypeString:
-		return s_symString;
-	case TypeHtml:
-		return s_symHtml;
-	case TypeXml:
-		return s_symXml;
-	case TypeLob:
-		return s_symLob;
-	case TypeBml:
-		return s_symBml;
-	case FrameStart:
-		return s_symFrameStart;
-	case FrameName:
-		return s_symFrameName;
-	case FrameNameStr:
-		return s_symFrameNameStr;
-	case FrameNameIdx:
-		return s_symFrameNameIdx;
-	case FrameNameTag:
-		return s_symFrameNameTag;
-	case FrameEnd:
-		return s_symFrameEnd;
-	case SlotNameStr:
-		return s_symSlotNameStr;
-	case SlotNameIdx:
-		return s_symSlotNameIdx;
-	case SlotNameTag:
-		return s_symSlotNameTag;
-	case SlotName:
-		return s_symSlotName;
-	case TypeUrl:
-		return s_symUrl;
-	case TypeImg:
-		return s_symImg;
-	case TypePic:
-		return s_symPic;
-	case TypeUuid:
-		return s_symUuid;
-	default:
-		throw StreamException( StreamException::IncompleteImplementation, 
-			"Not symbol defined for given value type" );
-	}
-	return TypeInvalid;
-}
-
 const int DataCell::UNISTR = -1;
 const int DataCell::CSTRING = -2;
 const int DataCell::BINARY = -3;
 const int DataCell::MBYTE64 = -4;
 const int DataCell::MBYTE32 = -5;
+const int DataCell::CHUNKED = -6;
 const int DataCell::typeByteCount[] =
 {
 	0,					// TypeNull,
@@ -325,6 +139,9 @@ const int DataCell::typeByteCount[] =
 	4,					// TypeTag
 	0,					// MaxType
 	0,					// FrameStart
+	4,					// FrameStartSized
+	BINARY,				// FramePacked
+	CHUNKED,			// LobChunked
 	4,					// FrameName
 	CSTRING,			// FrameNameStr
 	MBYTE32,			// FrameNameIdx
@@ -336,6 +153,164 @@ const int DataCell::typeByteCount[] =
 	4,					// SlotNameTag
 	0,					// TypeInvalid
 };
+// Nach Symbol ohne Kompressionsflag; ersetzt die Fallunterscheidung in symToType und peekCell.
+// Ungenutzte Symbole ergeben TypeInvalid.
+#define _NO { TypeInvalid, 0, 0 }
+const DataCell::Symbol DataCell::symbolTable[128] =
+{
+	{ TypeNull, 0, 0 },							// 0
+	{ TypeTrue, 0, 0 },							// 1
+	{ TypeFalse, 0, 0 },						// 2
+	{ TypeInt32, 4, 0 },						// 3
+	{ TypeDouble, 8, 0 },						// 4
+	{ TypeFloat, 4, 0 },						// 5
+	_NO, _NO, _NO, _NO,							// 6..9
+	{ TypeDate, 4, 0 },							// 10
+	{ TypeTime, 4, 0 },							// 11
+	{ TypeDateTime, 8, 0 },						// 12
+	{ TypeTag, 4, 0 },							// 13
+	{ TypeUInt8, 1, 0 },						// 14
+	{ TypeInt64, 8, 0 },						// 15
+	{ TypeTimeSlot, 4, 0 },						// 16
+	{ TypeDateTime, 8, 0 },						// 17
+	{ TypeUInt16, 2, 0 },						// 18
+	_NO,										// 19
+	{ TypeAtom, 4, 0 },							// 20
+	_NO,										// 21
+	{ TypeUrl, CSTRING, 0 },					// 22
+	{ TypeUuid, BINARY, 0 },					// 23
+	{ TypeOid, MBYTE64, 0 },					// 24
+	{ TypeId32, MBYTE32, 0 },					// 25
+	{ TypeId64, MBYTE64, 0 },					// 26
+	{ TypeSid, MBYTE32, 0 },					// 27
+	{ TypeRid, MBYTE64, 0 },					// 28
+	{ TypeUInt64, 8, 0 },						// 29
+	{ TypeUInt32, 4, 0 },						// 30
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 31..38
+	_NO,										// 39
+	{ TypeLatin1, CSTRING, 0 },					// 40
+	{ TypeString, UNISTR, 0 },					// 41
+	{ TypeHtml, UNISTR, 0 },					// 42
+	{ TypeXml, UNISTR, 0 },						// 43
+	{ TypeAscii, CSTRING, 0 },					// 44
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 45..52
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO,			// 53..59
+	{ TypeLob, BINARY, 0 },						// 60
+	_NO, _NO, _NO,								// 61..63
+	{ TypeImg, BINARY, 0 },						// 64
+	{ TypePic, BINARY, 0 },						// 65
+	{ TypeBml, BINARY, 0 },						// 66
+	{ LobChunked, CHUNKED, 0 },					// 67
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 68..75
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 76..83
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 84..91
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 92..99
+	_NO, _NO, _NO, _NO, _NO, _NO, _NO, _NO,		// 100..107
+	_NO, _NO,									// 108..109
+	{ FrameStart, 0, 0 },						// 110
+	{ FrameName, 4, Symbol::OfFrame },			// 111
+	{ FrameEnd, 0, 0 },							// 112
+	{ SlotName, 4, Symbol::OfSlot },			// 113
+	{ FrameNameStr, CSTRING, Symbol::OfFrame },	// 114
+	{ SlotNameStr, CSTRING, Symbol::OfSlot },	// 115
+	{ FrameNameTag, 4, Symbol::OfFrame },		// 116
+	{ SlotNameTag, 4, Symbol::OfSlot },			// 117
+	{ FrameNameIdx, MBYTE32, Symbol::OfFrame },	// 118
+	{ SlotNameIdx, MBYTE32, Symbol::OfSlot },	// 119
+	{ FrameStartSized, 4, 0 },					// 120
+	{ FramePacked, BINARY, 0 },					// 121
+	_NO, _NO, _NO, _NO, _NO, _NO,				// 122..127
+};
+#undef _NO
+// Nach DataType; s_symInvalid..kein Symbol
+static const quint8 s_typeToSym[DataCell::TypeInvalid + 1] =
+{
+	s_symNull,				// TypeNull
+	s_symTrue,				// TypeTrue
+	s_symFalse,				// TypeFalse
+	s_symAtom,				// TypeAtom
+	s_symOid64,				// TypeOid
+	s_symRid,				// TypeRid
+	s_symSid,				// TypeSid
+	s_symId32,				// TypeId32
+	s_symId64,				// TypeId64
+	s_symUInt8,				// TypeUInt8
+	s_symUInt16,			// TypeUInt16
+	s_symInt32,				// TypeInt32
+	s_symUInt32,			// TypeUInt32
+	s_symInt64,				// TypeInt64
+	s_symUInt64,			// TypeUInt64
+	s_symDouble,			// TypeDouble
+	s_symFloat,				// TypeFloat
+	s_symLatin1,			// TypeLatin1
+	s_symAscii,				// TypeAscii
+	s_symString,			// TypeString
+	s_symLob,				// TypeLob
+	s_symBml,				// TypeBml
+	s_symDate,				// TypeDate
+	s_symTime,				// TypeTime
+	s_symDateTimeNew,		// TypeDateTime
+	s_symTimeSlot,			// TypeTimeSlot
+	s_symUrl,				// TypeUrl
+	s_symImg,				// TypeImg
+	s_symPic,				// TypePic
+	s_symUuid,				// TypeUuid
+	s_symHtml,				// TypeHtml
+	s_symXml,				// TypeXml
+	s_symTag,				// TypeTag
+	s_symInvalid,			// MaxType
+	s_symFrameStart,		// FrameStart
+	s_symFrameStartSized,	// FrameStartSized
+	s_symFramePacked,		// FramePacked
+	s_symLobChunked,		// LobChunked
+	s_symFrameName,			// FrameName
+	s_symFrameNameStr,		// FrameNameStr
+	s_symFrameNameIdx,		// FrameNameIdx
+	s_symFrameNameTag,		// FrameNameTag
+	s_symFrameEnd,			// FrameEnd
+	s_symSlotName,			// SlotName
+	s_symSlotNameStr,		// SlotNameStr
+	s_symSlotNameIdx,		// SlotNameIdx
+	s_symSlotNameTag,		// SlotNameTag
+	s_symInvalid,			// TypeInvalid
+};
+
+quint8 DataCell::typeToSym( DataType t )
+{
+	const quint8 sym = ( t >= 0 && t <= TypeInvalid )?s_typeToSym[t]:s_symInvalid;
+	if( sym == s_symInvalid )
+		throw StreamException( StreamException::IncompleteImplementation, 
+			"Not symbol defined for given value type" );
+	return sym;
+}
+
+void DataCell::test()
+{
+	for( quint8 sym = 0; sym < 128; sym++ )
+	{
+		const Symbol& s = getSymbol( sym );
+		if( s.d_type == TypeInvalid )
+			continue;
+		const bool frameName = s.d_type >= FrameName && s.d_type <= FrameNameTag;
+		const bool slotName = s.d_type >= SlotName && s.d_type <= SlotNameTag;
+		if( s.d_count != typeByteCount[s.d_type] || isFrameNameSym( sym ) != frameName ||
+			isSlotNameSym( sym ) != slotName )
+		{
+			qDebug( "failed symbol %d", sym );
+			Q_ASSERT( false );
+		}
+	}
+	for( int t = 0; t < TypeInvalid; t++ )
+	{
+		if( s_typeToSym[t] != s_symInvalid && symToType( s_typeToSym[t] ) != t )
+		{
+			qDebug( "failed type %d", t );
+			Q_ASSERT( false );
+		}
+	}
+	qDebug( "done" );
+}
+
 const char* DataCell::typePrettyName[] =
 {
 	"Null",				// TypeNull,
@@ -406,17 +381,20 @@ const quint32 DataCell::null = 0;
 
 void DataCell::clear()
 {
-	if( typeByteCount[d_type] == UNISTR )
+	const int len = typeByteCount[d_type];
+	if( len == UNISTR && !d_utf8 )
 	{
 		QString* s = (QString*) d_buf;
 		s->~QString();
-	}else if( typeByteCount[d_type] == BINARY || typeByteCount[d_type] == CSTRING )
+	}else if( ( len == BINARY || len == CSTRING || len == UNISTR ) && d_inline == NotInline )
 	{
 		QByteArray* ba = (QByteArray*) d_buf;
 		ba->~QByteArray();
 	}
 	d_uint64 = 0;
 	d_type = TypeInvalid;
+	d_inline = 0;
+	d_utf8 = false;
 }
 
 DataCell& DataCell::setNull()
@@ -430,17 +408,464 @@ void DataCell::assign( const DataCell& rhs )
 {
 	clear();
 	d_type = rhs.d_type;
-	if( typeByteCount[d_type] == UNISTR )
+	const int len = typeByteCount[d_type];
+	if( len == UNISTR && !rhs.d_utf8 )
 	{
-		setStr( rhs.getStr() );
-	}else if( typeByteCount[d_type] == BINARY || typeByteCount[d_type] == CSTRING )
+		setStr( *(const QString*) rhs.d_buf );
+	}else if( len == BINARY || len == CSTRING || len == UNISTR )
 	{
-		setArr( rhs.getArr() );
+		if( rhs.d_inline != NotInline )
+		{
+			::memcpy( d_buf, rhs.d_buf, rhs.d_inline );
+			d_inline = rhs.d_inline;
+		}else
+			setArr( *(const QByteArray*) rhs.d_buf );
+		d_utf8 = rhs.d_utf8;
 	}else
 		::memcpy( d_buf, rhs.d_buf, sizeof(double) );
 
 }
 
+namespace Stream
+{
+	// Liefert die Codepoints eines UNISTR, egal ob als UTF-8 oder als QString gespeichert.
+	// Ungltiges UTF-8 ergibt wie bei QString::fromUtf8 pro ungltigem Byte ein U+FFFD.
+	struct _CodePoints
+	{
+		const char* d_utf8;
+		const QChar* d_utf16;
+		quint32 d_len;
+		quint32 d_pos;
+		bool d_invalid; // next hat U+FFFD fr ungltiges UTF-8 geliefert
+
+		bool atEnd() const { return d_pos >= d_len; }
+		quint32 next()
+		{
+			if( d_utf16 )
+			{
+				const quint32 c = d_utf16[d_pos++].unicode();
+				if( c >= 0xd800 && c < 0xdc00 && d_pos < d_len )
+				{
+					const quint32 l = d_utf16[d_pos].unicode();
+					if( l >= 0xdc00 && l < 0xe000 )
+					{
+						d_pos++;
+						return 0x10000 + ( ( c - 0xd800 ) << 10 ) + ( l - 0xdc00 );
+					}
+				}
+				return c;
+			}
+			const quint8 c = d_utf8[d_pos++];
+			if( c < 0x80 )
+				return c;
+			int n;
+			quint32 res, min;
+			if( c >= 0xc2 && c < 0xe0 )
+			{
+				n = 1;
+				res = c & 0x1f;
+				min = 0x80;
+			}else if( c >= 0xe0 && c < 0xf0 )
+			{
+				n = 2;
+				res = c & 0x0f;
+				min = 0x800;
+			}else if( c >= 0xf0 && c < 0xf5 )
+			{
+				n = 3;
+				res = c & 0x07;
+				min = 0x10000;
+			}else
+				return invalid();
+			if( d_len - d_pos < quint32(n) )
+				return invalid();
+			for( int i = 0; i < n; i++ )
+			{
+				const quint8 b = d_utf8[d_pos + i];
+				if( ( b & 0xc0 ) != 0x80 )
+					return invalid();
+				res = ( res << 6 ) | ( b & 0x3f );
+			}
+			// berlange Sequenzen, Surrogates und Werte ber U+10FFFF sind ungltig
+			if( res < min || res > 0x10ffff || ( res >= 0xd800 && res < 0xe000 ) )
+				return invalid();
+			d_pos += n;
+			return res;
+		}
+		quint32 invalid()
+		{
+			// Wie QString::fromUtf8 wird nur das erste Byte der Sequenz verbraucht
+			d_invalid = true;
+			return 0xfffd;
+		}
+		bool isValid() const
+		{
+			// true..der Rest ist gltiges UTF-8 bzw. UTF-16; ASCII wird wortweise geprft
+			if( d_utf16 )
+				return true;
+			_CodePoints cp = *this;
+			while( !cp.atEnd() && !cp.d_invalid )
+			{
+				quint64 w;
+				if( cp.d_len - cp.d_pos >= sizeof(w) )
+				{
+					::memcpy( &w, cp.d_utf8 + cp.d_pos, sizeof(w) );
+					if( ( w & Q_UINT64_C( 0x8080808080808080 ) ) == 0 )
+					{
+						cp.d_pos += sizeof(w);
+						continue;
+					}
+				}
+				cp.next();
+			}
+			return !cp.d_invalid;
+		}
+	};
+
+	// Verarbeitet 8 Bytes aufs Mal; Byte fr Byte ergibt dasselbe Resultat.
+	class _Hash
+	{
+	public:
+		_Hash( uint seed ):d_h( Q_UINT64_C( 0x9e3779b97f4a7c15 ) ^ seed ),d_word(0),d_bytes(0),d_len(0) {}
+		void add( quint8 b )
+		{
+			d_word |= quint64( b ) << ( 8 * d_bytes );
+			d_len++;
+			if( ++d_bytes == 8 )
+			{
+				mix( d_word );
+				d_word = 0;
+				d_bytes = 0;
+			}
+		}
+		void add( const char* data, quint32 len )
+		{
+			const quint8* p = (const quint8*)data;
+			while( len > 0 && d_bytes != 0 )
+			{
+				add( *p++ );
+				len--;
+			}
+			while( len >= 8 )
+			{
+				mix( quint64(p[0]) | quint64(p[1]) << 8 | quint64(p[2]) << 16 | quint64(p[3]) << 24 |
+					 quint64(p[4]) << 32 | quint64(p[5]) << 40 | quint64(p[6]) << 48 | quint64(p[7]) << 56 );
+				p += 8;
+				len -= 8;
+				d_len += 8;
+			}
+			while( len-- > 0 )
+				add( *p++ );
+		}
+		void addUtf8( quint32 c )
+		{
+			if( c < 0x80 )
+				add( quint8( c ) );
+			else if( c < 0x800 )
+			{
+				add( quint8( 0xc0 | ( c >> 6 ) ) );
+				add( quint8( 0x80 | ( c & 0x3f ) ) );
+			}else if( c < 0x10000 )
+			{
+				add( quint8( 0xe0 | ( c >> 12 ) ) );
+				add( quint8( 0x80 | ( ( c >> 6 ) & 0x3f ) ) );
+				add( quint8( 0x80 | ( c & 0x3f ) ) );
+			}else
+			{
+				add( quint8( 0xf0 | ( c >> 18 ) ) );
+				add( quint8( 0x80 | ( ( c >> 12 ) & 0x3f ) ) );
+				add( quint8( 0x80 | ( ( c >> 6 ) & 0x3f ) ) );
+				add( quint8( 0x80 | ( c & 0x3f ) ) );
+			}
+		}
+		uint result()
+		{
+			if( d_bytes != 0 )
+				mix( d_word );
+			mix( d_len );
+			return uint( d_h ^ ( d_h >> 32 ) );
+		}
+	private:
+		void mix( quint64 v )
+		{
+			d_h ^= v;
+			d_h *= Q_UINT64_C( 0xff51afd7ed558ccd );
+			d_h ^= d_h >> 33;
+		}
+		quint64 d_h;
+		quint64 d_word;
+		int d_bytes;
+		quint64 d_len;
+	};
+}
+
+_CodePoints DataCell::codePoints() const
+{
+	_CodePoints res;
+	res.d_pos = 0;
+	res.d_invalid = false;
+	if( d_utf8 || typeByteCount[d_type] != UNISTR )
+	{
+		res.d_utf16 = 0;
+		res.d_utf8 = rawArr( res.d_len );
+	}else
+	{
+		const QString* str = (const QString*) d_buf;
+		res.d_utf8 = 0;
+		res.d_utf16 = str->unicode();
+		res.d_len = str->size();
+	}
+	return res;
+}
+
+int DataCell::compareText( const DataCell& lhs, const DataCell& rhs )
+{
+	_CodePoints a = lhs.codePoints();
+	_CodePoints b = rhs.codePoints();
+	while( !a.atEnd() && !b.atEnd() )
+	{
+		const quint32 ca = a.next();
+		const quint32 cb = b.next();
+		if( ca != cb )
+			return ( ca < cb )?-1:1;
+	}
+	return ( a.atEnd() && b.atEnd() )?0:( a.atEnd() )?-1:1;
+}
+
+enum { _RankInvalid, _RankNull, _RankFalse, _RankTrue, _RankNumber, _RankOther };
+
+static int _rank( DataCell::DataType t )
+{
+	switch( t )
+	{
+	case DataCell::TypeNull:
+		return _RankNull;
+	case DataCell::TypeFalse:
+		return _RankFalse;
+	case DataCell::TypeTrue:
+		return _RankTrue;
+	case DataCell::TypeUInt8:
+	case DataCell::TypeUInt16:
+	case DataCell::TypeInt32:
+	case DataCell::TypeUInt32:
+	case DataCell::TypeInt64:
+	case DataCell::TypeUInt64:
+	case DataCell::TypeDouble:
+	case DataCell::TypeFloat:
+		return _RankNumber;
+	case DataCell::TypeInvalid:
+		return _RankInvalid;
+	default:
+		return _RankOther;
+	}
+}
+
+template<class T>
+static inline int _cmp( T a, T b )
+{
+	return ( a < b )?-1:( b < a )?1:0;
+}
+
+// Zahlen als vorzeichenbehaftete, vorzeichenlose oder Fliesskommazahl
+struct _Number
+{
+	enum Kind { Signed, Unsigned, Float };
+	Kind d_kind;
+	union
+	{
+		qint64 d_s;
+		quint64 d_u;
+		double d_d;
+	};
+	_Number( const DataCell& v )
+	{
+		switch( v.getType() )
+		{
+		case DataCell::TypeUInt8:
+			d_kind = Unsigned;
+			d_u = v.getUInt8();
+			break;
+		case DataCell::TypeUInt16:
+			d_kind = Unsigned;
+			d_u = v.getUInt16();
+			break;
+		case DataCell::TypeUInt32:
+			d_kind = Unsigned;
+			d_u = v.getUInt32();
+			break;
+		case DataCell::TypeUInt64:
+			d_kind = Unsigned;
+			d_u = v.getUInt64();
+			break;
+		case DataCell::TypeInt32:
+			d_kind = Signed;
+			d_s = v.getInt32();
+			break;
+		case DataCell::TypeInt64:
+			d_kind = Signed;
+			d_s = v.getInt64();
+			break;
+		case DataCell::TypeFloat:
+			d_kind = Float;
+			d_d = v.getFloat();
+			break;
+		default:
+			d_kind = Float;
+			d_d = v.getDouble();
+			break;
+		}
+	}
+};
+
+static int _compareIntFloat( const _Number& i, double d )
+{
+	// Exakt, ohne die Ganzzahl auf double zu runden; NaN steht nach allen Zahlen.
+	if( d != d || d >= 18446744073709551616.0 )
+		return -1;
+	if( d < -9223372036854775808.0 )
+		return 1;
+	int res;
+	double t;
+	if( i.d_kind == _Number::Signed )
+	{
+		if( d >= 9223372036854775808.0 )
+			return -1;
+		const qint64 n = qint64( d ); // Richtung 0, im Bereich exakt
+		res = _cmp( i.d_s, n );
+		t = double( n );
+	}else
+	{
+		if( d < 0.0 )
+			return 1;
+		const quint64 n = quint64( d );
+		res = _cmp( i.d_u, n );
+		t = double( n );
+	}
+	if( res != 0 )
+		return res;
+	return _cmp( 0.0, d - t ); // Nachkommateil
+}
+
+static int _compareNumbers( const _Number& a, const _Number& b )
+{
+	if( a.d_kind == _Number::Float && b.d_kind == _Number::Float )
+	{
+		const bool na = a.d_d != a.d_d;
+		const bool nb = b.d_d != b.d_d;
+		if( na || nb )
+			return _cmp( na, nb );
+		return _cmp( a.d_d, b.d_d );
+	}
+	if( a.d_kind == _Number::Float )
+		return -_compareIntFloat( b, a.d_d );
+	if( b.d_kind == _Number::Float )
+		return _compareIntFloat( a, b.d_d );
+	if( a.d_kind == b.d_kind )
+		return ( a.d_kind == _Number::Signed )?_cmp( a.d_s, b.d_s ):_cmp( a.d_u, b.d_u );
+	if( a.d_kind == _Number::Signed )
+		return ( a.d_s < 0 )?-1:_cmp( quint64( a.d_s ), b.d_u );
+	return ( b.d_s < 0 )?1:_cmp( a.d_u, quint64( b.d_s ) );
+}
+
+int DataCell::compare( const DataCell& rhs ) const
+{
+	const int rank = _rank( getType() );
+	int res = _cmp( rank, _rank( rhs.getType() ) );
+	if( res != 0 )
+		return res;
+	if( rank == _RankNumber )
+	{
+		res = _compareNumbers( _Number( *this ), _Number( rhs ) );
+		if( res != 0 )
+			return res;
+	}
+	if( d_type != rhs.d_type )
+		return _cmp( typeToSym( getType() ), typeToSym( rhs.getType() ) );
+	switch( typeByteCount[d_type] )
+	{
+	case UNISTR:
+		// Nur gltiges UTF-8 hat dieselbe Reihenfolge wie die Codepoints
+		if( !d_utf8 || !rhs.d_utf8 || !codePoints().isValid() || !rhs.codePoints().isValid() )
+			return compareText( *this, rhs );
+		// else fall through
+	case BINARY:
+	case CSTRING:
+		{
+			quint32 l1, l2;
+			const char* a1 = rawBytes( l1 );
+			const char* a2 = rhs.rawBytes( l2 );
+			res = ::memcmp( a1, a2, qMin( l1, l2 ) );
+			return ( res != 0 )?( ( res < 0 )?-1:1 ):_cmp( l1, l2 );
+		}
+	}
+	switch( d_type )
+	{
+	case TypeAtom:
+	case TypeSid:
+	case TypeId32:
+		res = _cmp( d_uint32, rhs.d_uint32 );
+		break;
+	case TypeOid:
+	case TypeRid:
+	case TypeId64:
+		res = _cmp( d_uint64, rhs.d_uint64 );
+		break;
+	case TypeDate:
+	case TypeTime:
+		res = _cmp( d_int32, rhs.d_int32 );
+		break;
+	case TypeDateTime:
+		res = _cmp( d_pair[1], rhs.d_pair[1] ); // Datum
+		if( res == 0 )
+			res = _cmp( d_pair[0], rhs.d_pair[0] );
+		break;
+	case TypeTimeSlot:
+		res = _cmp( d_pair[0], rhs.d_pair[0] );
+		if( res == 0 )
+			res = _cmp( d_pair[1], rhs.d_pair[1] );
+		break;
+	case TypeTag:
+		res = ::memcmp( d_buf, rhs.d_buf, NameTag::Size );
+		break;
+	default:
+		break;
+	}
+	if( res == 0 )
+		res = ::memcmp( d_buf, rhs.d_buf, sizeof(double) ); // wie equals, z.B. -0.0 und 0.0
+	return ( res < 0 )?-1:( res > 0 )?1:0;
+}
+
+uint DataCell::hash( uint seed ) const
+{
+	_Hash h( seed );
+	h.add( d_type );
+	switch( typeByteCount[d_type] )
+	{
+	case UNISTR:
+		if( !d_utf8 || !codePoints().isValid() )
+		{
+			// Gleiches Resultat wie fr die UTF-8-Bytes bzw. wie fr getStr()
+			_CodePoints cp = codePoints();
+			while( !cp.atEnd() )
+				h.addUtf8( cp.next() );
+			break;
+		}
+		// else fall through
+	case BINARY:
+	case CSTRING:
+		{
+			quint32 len;
+			const char* str = rawBytes( len );
+			h.add( str, len );
+		}
+		break;
+	default:
+		h.add( (const char*)d_buf, sizeof(double) );
+		break;
+	}
+	return h.result();
+}
+
 bool DataCell::equals( const DataCell& rhs ) const
 {
 	if( d_type != rhs.d_type )
@@ -448,10 +873,17 @@ bool DataCell::equals( const DataCell& rhs ) const
 	switch( typeByteCount[d_type] )
 	{
 	case UNISTR:
-		return getStr() == rhs.getStr();
+		if( !d_utf8 || !rhs.d_utf8 || !codePoints().isValid() || !rhs.codePoints().isValid() )
+			return compareText( *this, rhs ) == 0;
+		// else fall through
 	case BINARY:
 	case CSTRING:
-		return getArr() == rhs.getArr();
+		{
+			quint32 l1, l2;
+			const char* a1 = rawBytes( l1 );
+			const char* a2 = rhs.rawBytes( l2 );
+			return l1 == l2 && ::memcmp( a1, a2, l1 ) == 0;
+		}
 	default:
 		return ::memcmp( d_buf, rhs.d_buf, sizeof(double) ) == 0;
 	}
@@ -462,32 +894,109 @@ void DataCell::setStr( const QString& in )
 {
 	assert( sizeof(d_buf) >= sizeof(QString) );
     new( d_buf ) QString( in );
+	d_utf8 = false;
+}
+
+void DataCell::setUtf8( const QByteArray& in )
+{
+	setArr( in );
+	d_utf8 = true;
+}
+
+void DataCell::setUtf8( const char* data, quint32 len )
+{
+	setArr( data, len );
+	d_utf8 = true;
 }
 
 QString DataCell::getStr() const 
 { 
 	if( typeByteCount[d_type] != UNISTR )
 		return QString();
+	if( d_utf8 )
+	{
+		// Wird bei jedem Aufruf dekodiert; der const DataCell wird nicht verndert.
+		quint32 len;
+		const char* str = rawBytes( len );
+		return QString::fromUtf8( str, len );
+	}
 	return *(QString*) d_buf;
 }
 
+QByteArray DataCell::getUtf8() const
+{
+	if( typeByteCount[d_type] != UNISTR )
+		return QByteArray();
+	if( !d_utf8 )
+		return getStr().toUtf8();
+	if( d_inline != NotInline )
+		return QByteArray( (const char*)d_buf, d_inline );
+	return *(QByteArray*) d_buf;
+}
+
+void DataCell::decodeStr()
+{
+	if( typeByteCount[d_type] != UNISTR || !d_utf8 )
+		return;
+	const QString str = getStr();
+	const quint8 type = d_type;
+	clear();
+	d_type = type;
+	setStr( str );
+}
+
 QByteArray DataCell::getArr() const 
 { 
-	if( typeByteCount[d_type] != BINARY && typeByteCount[d_type] != CSTRING )
+	if( !isArr() )
 		return QByteArray();
+	if( d_inline != NotInline )
+		return QByteArray( (const char*)d_buf, d_inline );
 	return *(QByteArray*) d_buf;
 }
 
-void DataCell::setArr( const QByteArray& in )
+const char* DataCell::rawArr( quint32& len ) const
 {
-	assert( sizeof(d_buf) >= sizeof(QByteArray) );
-    new( d_buf ) QByteArray( in );
+	if( !hasBytes() )
+	{
+		len = 0;
+		return "";
+	}
+	return rawBytes( len );
 }
 
-DataCell& DataCell::setLatin1( const QByteArray& str, bool nullIfEmpty )
+void DataCell::setArr( const QByteArray& in )
 {
-	clear();
-	if( !nullIfEmpty || !str.isEmpty() )
+	assert( sizeof(d_buf) >= sizeof(QByteArray) );
+	// Ein Null-QByteArray bleibt ein solches, damit getArr().isNull() unverndert funktioniert.
+	if( !in.isNull() && in.size() <= InlineSize )
+	{
+		::memcpy( d_buf, in.constData(), in.size() );
+		d_inline = in.size();
+	}else
+	{
+		new( d_buf ) QByteArray( in );
+		d_inline = NotInline;
+	}
+}
+
+void DataCell::setArr( const char* data, quint32 len )
+{
+	// Wie setArr( QByteArray( data, len ) ), aber ohne Allokation bei kurzen Werten
+	if( len <= InlineSize )
+	{
+		::memcpy( d_buf, data, len );
+		d_inline = len;
+	}else
+	{
+		new( d_buf ) QByteArray( data, len );
+		d_inline = NotInline;
+	}
+}
+
+DataCell& DataCell::setLatin1( const QByteArray& str, bool nullIfEmpty )
+{
+	clear();
+	if( !nullIfEmpty || !str.isEmpty() )
 	{
 		d_type = TypeLatin1;
 		setArr( str );
@@ -727,14 +1236,13 @@ TimeSlot DataCell::getTimeSlot() const
 DataCell& DataCell::setUuid( const QUuid& u )
 {
 	clear();
-	QByteArray buf;
-	buf.resize( _UUID_LEN );
-	quint32 i = Helper::write( buf.data(), u.data1 );
-	i += Helper::write( buf.data() + i, u.data2 );
-	i += Helper::write( buf.data() + i, u.data3 );
+	char buf[_UUID_LEN];
+	quint32 i = Helper::write( buf, u.data1 );
+	i += Helper::write( buf + i, u.data2 );
+	i += Helper::write( buf + i, u.data3 );
 	Q_ASSERT( i == _UUID_LEN / 2 );
-	::memcpy( buf.data() + i, u.data4, 8 );
-	setArr( buf );
+	::memcpy( buf + i, u.data4, 8 );
+	setArr( buf, _UUID_LEN );
 	d_type = TypeUuid;
 	return *this;
 }
@@ -744,13 +1252,14 @@ QUuid DataCell::getUuid() const
 	if( d_type != TypeUuid )
 		return QUuid();
 
-	QByteArray buf = getArr();
-	Q_ASSERT( getArr().length() >= _UUID_LEN );
+	quint32 len;
+	const char* buf = rawBytes( len );
+	Q_ASSERT( len >= _UUID_LEN );
 	QUuid u;
-	quint32 i = Helper::read( buf.data(), u.data1 );
-	i += Helper::read( buf.data() + i, u.data2 );
-	i += Helper::read( buf.data() + i, u.data3 );
-	::memcpy( u.data4, buf.data() + i, 8 );
+	quint32 i = Helper::read( buf, u.data1 );
+	i += Helper::read( buf + i, u.data2 );
+	i += Helper::read( buf + i, u.data3 );
+	::memcpy( u.data4, buf + i, 8 );
 	return u;
 }
 DataCell& DataCell::setImage( const QImage& img )
@@ -825,20 +1334,23 @@ DataCell& DataCell::setBml( const QByteArray& in )
 	return *this;
 }
 
-int DataCell::getByteCount()
+int DataCell::getByteCount() const
 {
-	if( typeByteCount[d_type] == UNISTR )
+	const int len = typeByteCount[d_type];
+	if( len == UNISTR && !d_utf8 )
 	{
 		return getStr().toUtf8().size() + 1;
-	}else if( typeByteCount[d_type] == BINARY || typeByteCount[d_type] == CSTRING )
+	}else if( hasBytes() )
 	{
-		return getArr().size() + 1;
-	}else if( typeByteCount[d_type] == MBYTE64 )
+		quint32 n;
+		rawBytes( n );
+		return n + 1;
+	}else if( len == MBYTE64 )
 		return 8;
-	else if( typeByteCount[d_type] == MBYTE32 )
+	else if( len == MBYTE32 )
 		return 4;
 	else
-		typeByteCount[d_type];
+		return len;
 }
 
 DataCell& DataCell::setTag( const NameTag& t )
@@ -858,27 +1370,38 @@ NameTag DataCell::getTag() const
 		return d_uint32;
 }
 
-static inline void _writeArray( QIODevice* out, DataCell::DataType t, QByteArray str, 
-							   bool dataOnly, bool compressed, bool string )
+static inline void _writeArray( QByteArray& out, DataCell::DataType t, const char* str, quint32 len,
+							   bool dataOnly, bool compressed, bool string, quint8 codec, quint32 dict )
 {
-	quint32 len = str.length();
 	if( string )
 	{
 		// korrigiere hier, dass QByteArray::fromRawData bei length das Nullzeichen mitzhlt.
 		if( len > 0 && str[len-1] == char(0) )
-			len = ::strlen( str ); 
-		// verwende nicht truncate, da dann der Speicher umalloziiert wird
-		if( str[len] != char(0) )
-			qWarning( "DataCell:_writeArray: string without terminating null" );
-		len += 1; 
+			len = qstrnlen( str, len ); 
+		len += 1; // das Nullzeichen wird unten angehngt
 	}
-	if( len <= s_compressionThreshold )
+	if( len <= ( ( dict != 0 )?s_dictThreshold:s_compressionThreshold ) )
 		compressed = false;
+	QByteArray tmp;
 	if( compressed )
 	{
 		// verwende hier nicht direkt QByteArray wegen obigem Problem mit Nullzeichen
-		str = qCompress( reinterpret_cast<const uchar*>(str.data()), len, 7 ); // RISK. -1 entspricht 6
-		len = str.length();
+		if( string )
+		{
+			tmp = QByteArray( str, len - 1 ); // hat Nullzeichen am Ende
+			str = tmp.constData();
+		}
+		const QByteArray packed = Codec::pack( codec, str, len, dict );
+		if( packed.isEmpty() || ( dict != 0 && quint32(packed.size()) >= len ) )
+			// Codec nicht verfgbar oder Fehler; bei kurzen Werten auch, wenn es nichts bringt
+			compressed = false;
+		else
+		{
+			tmp = packed;
+			str = tmp.constData();
+			len = tmp.length();
+			string = false;
+		}
 	}
 	if( !dataOnly )
 	{
@@ -890,124 +1413,192 @@ static inline void _writeArray( QIODevice* out, DataCell::DataType t, QByteArray
 	}
 	if( dataOnly && len == 0 )
 		Helper::write( out, quint8( 0 ) ); // Damit sicher etwas geschrieben wird
-	else
-		out->write( str, len );
+	else if( string )
+	{
+		out.append( str, len - 1 );
+		out.append( char(0) );
+	}else
+		out.append( str, len );
 }
 
-void DataCell::writeCell( QIODevice* out, bool dataOnly, bool compressed ) const
+void DataCell::writeCell( QIODevice* out, bool dataOnly, bool compressed, quint8 codec, quint32 dict ) const
+{
+	Q_ASSERT( out != 0 );
+	// Die Zelle wird zuerst aufbereitet und dann mit einem einzigen write geschrieben.
+	QByteArray buf;
+	writeCell( buf, dataOnly, compressed, codec, dict );
+	out->write( buf );
+}
+
+void DataCell::writeCell( QByteArray& out, bool dataOnly, bool compressed, quint8 codec, quint32 dict ) const
 {
 	// Falls dataOnly==true, werden die Daten ohne Typ und Counter geschrieben. Dieses
 	// Format muss nicht mehr mit readCell gelesen werden, sondern dient z.B. zu Indizierungszwecken.
 
-	Q_ASSERT( out != 0 );
 	const DataType t = getType();
 	switch( typeByteCount[t] )
 	{
 	case UNISTR:
-		_writeArray( out, t, getStr().toUtf8(), dataOnly, compressed, true );
-		break;
+		if( !d_utf8 )
+		{
+			const QByteArray utf8 = getStr().toUtf8();
+			_writeArray( out, t, utf8.constData(), utf8.size(), dataOnly, compressed, true, codec, dict );
+			break;
+		}
+		// else fall through; die gelesenen Bytes werden unverndert geschrieben
 	case CSTRING:
-		_writeArray( out, t, getArr(), dataOnly, compressed, true );
-		break;
 	case BINARY:
-		_writeArray( out, t, getArr(), dataOnly, compressed, false );
+		{
+			quint32 len;
+			const char* str = rawArr( len );
+			_writeArray( out, t, str, len, dataOnly, compressed, typeByteCount[t] != BINARY, codec, dict );
+		}
 		break;
 	default:
-		if( !dataOnly )
-			Helper::write( out, typeToSym( t ) );
-		switch( getType() )
 		{
-		case TypeNull:
-			if( dataOnly )
-				Helper::write( out, quint8(0) ); 
-			break;
-		case TypeTrue:
-			if( dataOnly )
-				Helper::write( out, quint8(1) );
-			break;
-		case TypeFalse:
-			if( dataOnly )
-				Helper::write( out, quint8(0) );
-			break;
-		case TypeAtom:	
-			Helper::write( out, getAtom() );
-			break;
-		case TypeOid:	
-			Helper::writeMultibyte64( out, getOid() );
-			break;
-		case TypeRid:	
-			Helper::writeMultibyte64( out, getRid() );
-			break;
-		case TypeSid:	
-			Helper::writeMultibyte32( out, getSid() );
-			break;
-		case TypeId32:	
-			Helper::writeMultibyte32( out, getId32() );
-			break;
-		case TypeId64:	
-			Helper::writeMultibyte64( out, getId64() );
-			break;
-		case TypeUInt8:	
-			Helper::write( out, getUInt8() );
-			break;
-		case TypeUInt16:
-			Helper::write( out, getUInt16() );
-			break;
-		case TypeInt32:
-			Helper::write( out, getInt32() );
-			break;
-		case TypeUInt32:
-			Helper::write( out, getUInt32() );
-			break;
-		case TypeInt64:
-			Helper::write( out, getInt64() );
-			break;
-		case TypeUInt64:
-			Helper::write( out, getUInt64() );
-			break;
-		case TypeDouble:
-			Helper::write( out, getDouble() );
-			break;
-        case TypeFloat:
-			Helper::write( out, getFloat() );
-			break;
-		case TypeDate:
-			Helper::write( out, d_int32 );
-			break;
-		case TypeTime:
-			Helper::write( out, d_int32 );
-			break;
-		case TypeDateTime:
-            // s_symDateTimeNew:
-            Helper::write( out, d_pair[1] ); // Datum
-			Helper::write( out, d_pair[0] ); // Zeit
-            // s_symDateTimeOld:
-//          Helper::write( out, d_pair[0] ); // Zeit
-//			Helper::write( out, d_pair[1] ); // Datum
-			break;
-		case TypeTimeSlot:
-			Helper::write( out, quint16( d_pair[0] ) );
-			Helper::write( out, quint16( d_pair[1] ) );
-			break;
-		case TypeTag:
-			// Schreibt die Lnge nicht
-			out->write( (char*)d_buf, NameTag::Size );
-			break;
-		default:
-			throw StreamException( StreamException::IncompleteImplementation,
-				"writeCell: type not supported" );
+			BufferSink sink( out );
+			writeFixed( sink, dataOnly );
 		}
 		break;
 	}
 }
 
-QByteArray DataCell::writeCell(bool dataOnly, bool compressed) const
+QByteArray DataCell::writeCell(bool dataOnly, bool compressed, quint8 codec, quint32 dict) const
 {
-	QBuffer buf;
-	buf.open( QIODevice::WriteOnly );
-	writeCell( &buf, dataOnly, compressed );
-	buf.close();
-	return buf.buffer();
+	QByteArray buf;
+	writeCell( buf, dataOnly, compressed, codec, dict );
+	return buf;
+}
+
+static void _writeKeyBytes( QByteArray& out, const char* data, quint32 len )
+{
+	// Nullbytes werden als 00 FF geschrieben und das Ende als 00 01, damit ein Wert vor allen
+	// Werten steht, die mit ihm beginnen, auch wenn danach noch weitere Schlssel folgen.
+	quint32 start = 0;
+	for( quint32 i = 0; i < len; i++ )
+	{
+		if( data[i] == 0 )
+		{
+			out.append( data + start, i + 1 - start );
+			out.append( char(0xff) );
+			start = i + 1;
+		}
+	}
+	out.append( data + start, len - start );
+	out.append( char(0) );
+	out.append( char(1) );
+}
+
+void DataCell::writeKey( QByteArray& out, bool descending ) const
+{
+	const int start = out.size();
+	const DataType t = getType();
+	// Zuerst der Typ, damit verschiedene Typen eine feste Reihenfolge haben; Null zuerst.
+	Helper::write( out, typeToSym( ( t == TypeTrue )?TypeFalse:t ) );
+	switch( t )
+	{
+	case TypeNull:
+		break;
+	case TypeTrue:
+		Helper::write( out, quint8(1) );
+		break;
+	case TypeFalse:
+		Helper::write( out, quint8(0) );
+		break;
+	case TypeAtom:
+		Helper::write( out, getAtom() );
+		break;
+	case TypeSid:
+	case TypeId32:
+	case TypeUInt32:
+		// Big Endian in fester Lnge statt Multibyte
+		Helper::write( out, d_uint32 );
+		break;
+	case TypeOid:
+	case TypeRid:
+	case TypeId64:
+	case TypeUInt64:
+		Helper::write( out, d_uint64 );
+		break;
+	case TypeUInt8:
+		Helper::write( out, getUInt8() );
+		break;
+	case TypeUInt16:
+		Helper::write( out, getUInt16() );
+		break;
+	case TypeInt32:
+	case TypeDate:
+	case TypeTime:
+		// Vorzeichenbit umkehren, damit negative Werte vor den positiven stehen
+		Helper::write( out, quint32( d_int32 ) ^ 0x80000000 );
+		break;
+	case TypeInt64:
+		Helper::write( out, quint64( getInt64() ) ^ Q_UINT64_C( 0x8000000000000000 ) );
+		break;
+	case TypeDouble:
+		{
+			// IEEE 754: bei negativen Werten alle Bits, sonst nur das Vorzeichenbit umkehren
+			const double d = ( getDouble() == 0.0 )?0.0:getDouble(); // -0.0 wie 0.0
+			quint64 i;
+			::memcpy( &i, &d, sizeof(i) );
+			Helper::write( out, ( i & Q_UINT64_C( 0x8000000000000000 ) )?~i:
+							   i ^ Q_UINT64_C( 0x8000000000000000 ) );
+		}
+		break;
+	case TypeFloat:
+		{
+			const float f = ( getFloat() == 0.0f )?0.0f:getFloat();
+			quint32 i;
+			::memcpy( &i, &f, sizeof(i) );
+			Helper::write( out, ( i & 0x80000000 )?~i:i ^ 0x80000000 );
+		}
+		break;
+	case TypeDateTime:
+		Helper::write( out, d_pair[1] ); // Datum
+		Helper::write( out, d_pair[0] ); // Zeit
+		break;
+	case TypeTimeSlot:
+		Helper::write( out, quint16( d_pair[0] ) );
+		Helper::write( out, quint16( d_pair[1] ) );
+		break;
+	case TypeTag:
+		out.append( (const char*)d_buf, NameTag::Size );
+		break;
+	case TypeUuid:
+		{
+			// Feste Lnge, darum ohne Ende
+			quint32 len;
+			const char* str = rawArr( len );
+			out.append( str, len );
+		}
+		break;
+	default:
+		if( hasBytes() && ( typeByteCount[t] != UNISTR || codePoints().isValid() ) )
+		{
+			quint32 len;
+			const char* str = rawArr( len );
+			_writeKeyBytes( out, str, len );
+		}else if( typeByteCount[t] == UNISTR )
+		{
+			const QByteArray utf8 = getStr().toUtf8(); // UTF-8 sortiert wie die Codepoints
+			_writeKeyBytes( out, utf8.constData(), utf8.size() );
+		}else
+			throw StreamException( StreamException::IncompleteImplementation,
+				"writeKey: type not supported" );
+	}
+	if( descending )
+	{
+		char* p = out.data();
+		for( int i = start; i < out.size(); i++ )
+			p[i] = ~p[i];
+	}
+}
+
+QByteArray DataCell::toKey( bool descending ) const
+{
+	QByteArray res;
+	writeKey( res, descending );
+	return res;
 }
 
 #ifdef __unused__
@@ -1020,6 +1611,47 @@ static qint64 _read( QIODevice* in, bool peek, char * data, qint64 maxSize )
 }
 #endif
 
+static int _peekChunks( const char* in, quint32 size, quint32& len )
+{
+	// Lnge der Stcke eines LobChunked nach dem Typsymbol; 1..ok, 0..es fehlen noch Bytes,
+	// -1..ungltiges Stck ab len
+	len = 0;
+	while( true )
+	{
+		if( len >= size )
+			return 0;
+		if( DataCell::symToType( in[len] ) != DataCell::TypeLob )
+			return -1;
+		const int n = Helper::peekMultibyte32( in + len + 1, size - len - 1 );
+		if( n < 0 )
+			return 0;
+		quint32 count;
+		Helper::readMultibyte32( in + len + 1, count, n );
+		if( quint64(len) + 1 + n + count > size )
+			return 0;
+		len += 1 + n + count;
+		if( count == 0 )
+			return 1; // Leeres Stck schliesst ab
+	}
+}
+
+static QByteArray _joinChunks( const char* in, quint32 len )
+{
+	// in enthlt die mit _peekChunks geprften Stcke
+	QByteArray res;
+	res.reserve( len );
+	quint32 pos = 0;
+	while( pos < len )
+	{
+		const int n = Helper::peekMultibyte32( in + pos + 1, len - pos - 1 );
+		quint32 count;
+		Helper::readMultibyte32( in + pos + 1, count, n );
+		res.append( in + pos + 1 + n, count );
+		pos += 1 + n + count;
+	}
+	return res;
+}
+
 DataCell::Peek DataCell::peekCell(QIODevice* in)
 {
 	Q_ASSERT( in != 0 );
@@ -1029,12 +1661,13 @@ DataCell::Peek DataCell::peekCell(QIODevice* in)
 
 	in->peek( buf, 1 );
 	Peek res;
-	res.d_type = symToType( buf[0] ); // throws
+	const Symbol& sym = getSymbol( buf[0] );
+	res.d_type = DataType( sym.d_type );
 
 	if( res.d_type >= TypeInvalid )
 		throw StreamException( StreamException::InvalidProtocol, "invalid type" );
 
-	int len = typeByteCount[ res.d_type ];
+	const int len = sym.d_count;
 	switch( len )
 	{
 	case UNISTR:
@@ -1074,85 +1707,251 @@ DataCell::Peek DataCell::peekCell(QIODevice* in)
 			res.d_len = n;
 		}
 		break;
+	case CHUNKED:
+		{
+			// Dazu mssen alle Stcke vorhanden sein; DataReader liest LobChunked stckweise.
+			const QByteArray buf = in->peek( in->bytesAvailable() );
+			const int ok = _peekChunks( buf.constData() + 1, buf.size() - 1, res.d_len );
+			if( ok < 0 )
+				throw StreamException( StreamException::InvalidProtocol, "invalid LOB chunk" );
+			if( ok == 0 )
+				return Peek();
+		}
+		break;
 	default:
 		res.d_len = len;
 	}
 	return res;
 }
 
-#include <zlib/zlib.h>
-static QByteArray myUncompress(const uchar* data, int nbytes)
+DataCell::DecodeStatus DataCell::tryPeekCell( const char* in, quint32 size, Peek& res, quint32* errorAt )
 {
-	// Direkte Kopie aus Qt-4.3.5. Diese Routine ist ab Qt 4.4 fehlerhaft
-    if (!data) {
-        qWarning("qUncompress: Data is null");
-        return QByteArray();
-    }
-    if (nbytes <= 4) {
-        if (nbytes < 4 || (data[0]!=0 || data[1]!=0 || data[2]!=0 || data[3]!=0))
-            qWarning("qUncompress: Input data is corrupted");
-        return QByteArray();
-    }
-    ulong expectedSize = (data[0] << 24) | (data[1] << 16) |
-                       (data[2] <<  8) | (data[3]);
-	/* NOTE: Qt setzt in qCompress die Originallnge als 32Bit-Zahl vor den Stream in folgender Weise, die plattformunabhngig ist:
-	        bazip.resize(len + 4);
-            bazip[0] = (nbytes & 0xff000000) >> 24;
-            bazip[1] = (nbytes & 0x00ff0000) >> 16;
-            bazip[2] = (nbytes & 0x0000ff00) >> 8;
-            bazip[3] = (nbytes & 0x000000ff);
-	*/
-    ulong len = qMax(expectedSize, 1ul);
-    QByteArray baunzip;
-    int res;
-    do {
-        baunzip.resize(len);
-        res = ::uncompress((uchar*)baunzip.data(), &len,
-                            (uchar*)data+4, nbytes-4);
-
-        switch (res) {
-        case Z_OK:
-            if ((int)len != baunzip.size())
-                baunzip.resize(len);
-            break;
-        case Z_MEM_ERROR:
-            qWarning("qUncompress: Z_MEM_ERROR: Not enough memory");
-            break;
-        case Z_BUF_ERROR:
-            len *= 2;
-            break;
-        case Z_DATA_ERROR:
-            qWarning("qUncompress: Z_DATA_ERROR: Input data is corrupted");
-            break;
-        }
-    } while (res == Z_BUF_ERROR);
+	res = Peek();
+	if( size < 1 )
+		return DecodePending;
+	const Symbol& sym = getSymbol( in[0] );
+	const DataType type = DataType( sym.d_type );
+	if( type >= TypeInvalid )
+	{
+		if( errorAt )
+			*errorAt = 0;
+		return DecodeInvalidType;
+	}
 
-    if (res != Z_OK)
-        baunzip = QByteArray();
+	const int len = sym.d_count;
+	int n;
+	switch( len )
+	{
+	case UNISTR:
+	case CSTRING:
+	case BINARY:
+		n = Helper::peekMultibyte32( in + 1, size - 1 );
+		if( n < 0 )
+			return DecodePending;
+		Helper::readMultibyte32( in + 1, res.d_len, n );
+		res.d_off = n;
+		break;
+	case MBYTE64:
+		n = Helper::peekMultibyte64( in + 1, size - 1 );
+		if( n < 0 )
+			return DecodePending;
+		res.d_len = n;
+		break;
+	case MBYTE32:
+		n = Helper::peekMultibyte32( in + 1, size - 1 );
+		if( n < 0 )
+			return DecodePending;
+		res.d_len = n;
+		break;
+	case CHUNKED:
+		n = _peekChunks( in + 1, size - 1, res.d_len );
+		if( n < 0 )
+		{
+			if( errorAt )
+				*errorAt = 1 + res.d_len;
+			res = Peek();
+			return DecodeInvalidChunk;
+		}
+		if( n == 0 )
+		{
+			res = Peek();
+			return DecodePending;
+		}
+		break;
+	default:
+		res.d_len = len;
+	}
+	res.d_type = type;
+	return DecodeOk;
+}
+
+DataCell::Peek DataCell::peekCell( const char* in, quint32 size )
+{
+	Peek res;
+	switch( tryPeekCell( in, size, res ) )
+	{
+	case DecodeInvalidType:
+		throw StreamException( StreamException::InvalidProtocol, "invalid type" );
+	case DecodeInvalidChunk:
+		throw StreamException( StreamException::InvalidProtocol, "invalid LOB chunk" );
+	default:
+		break; // Bei DecodePending ist res ungltig
+	}
+	return res;
+}
 
-    return baunzip;
+const char* DataCell::getStatusName( DecodeStatus s )
+{
+	switch( s )
+	{
+	case DecodeOk:
+		return "ok";
+	case DecodePending:
+		return "incomplete cell";
+	case DecodeInvalidType:
+		return "invalid type";
+	case DecodeInvalidChunk:
+		return "invalid LOB chunk";
+	case DecodeUnsupported:
+		return "type not supported";
+	case DecodeMissingCodec:
+		return "codec not available";
+	case DecodeCorrupt:
+		return "corrupt compressed data";
+	case DecodeTruncated:
+		return "truncated cell";
+	case DecodeInvalidCell:
+		return "invalid cell header";
+	}
+	return "";
+}
+
+QByteArray DataCell::uncompress( const char* data, quint32 len )
+{
+	return Codec::unpack( data, len );
+}
+
+static inline DataCell::DataType _valueType( DataCell::DataType type )
+{
+	// Namen werden als gewhnliche Werte gelesen
+	if( type == DataCell::FrameName || type == DataCell::SlotName )
+		return DataCell::TypeAtom;
+	else if( type == DataCell::FrameNameStr || type == DataCell::SlotNameStr )
+		return DataCell::TypeAscii; 
+	else if( type == DataCell::FrameNameIdx || type == DataCell::SlotNameIdx )
+		return DataCell::TypeId32; 
+	else if( type == DataCell::FrameNameTag || type == DataCell::SlotNameTag )
+		return DataCell::TypeTag;
+	else
+		return type;
+}
+
+static inline quint32 _cstrLen( const char* str, quint32 count )
+{
+	// Korrigiere hier, dass der gespeicherte String bereits ein Nullzeichen enthlt.
+	if( count > 0 && str[count-1] == char(0) )
+	{
+		// Prfe, ob der String ev. das Opfer von berzhligen Nullzeichen ist, was vor dieser
+		// Fehlerbehebung bei mehrmaligem read/write passieren konnte.
+		if( count > 1 && str[count-2] == char(0) )
+		{
+			count = ::strlen( str ) + 1; 
+			// Das passiert mit frheren DB-Dateien ziemlich hufig.
+			// qWarning( "DataCell::readCell string with more than one terminal null" );
+		}
+		return count - 1;
+	}
+	return count;
+}
+
+bool DataCell::readFixed( quint8 sym, const char* in )
+{
+	// in zeigt auf die typeByteCount[d_type] Bytes nach dem Typsymbol
+	switch( d_type )
+	{
+	case TypeNull:
+	case TypeTrue:
+	case TypeFalse:
+		break;
+	case TypeAtom:	
+		Helper::read( in, d_uint32 );
+		break;
+	case TypeUInt8:	
+		Helper::read( in, d_uint8 );
+		break;
+	case TypeUInt16:
+		Helper::read( in, d_uint16 );
+		break;
+	case TypeInt32:
+		Helper::read( in, d_int32 );
+		break;
+	case TypeUInt32:
+		Helper::read( in, d_uint32 );
+		break;
+	case TypeInt64:
+		Helper::read( in, d_int64 );
+		break;
+	case TypeUInt64:
+		Helper::read( in, d_uint64 );
+		break;
+	case TypeDouble:
+		Helper::read( in, d_double );
+		break;
+	case TypeFloat:
+		Helper::read( in, d_float );
+		break;
+	case TypeDate:
+		Helper::read( in, d_int32 );
+		break;
+	case TypeTime:
+		Helper::read( in, d_int32 );
+		break;
+	case TypeDateTime:
+		if( sym == s_symDateTimeOld )
+		{
+			Helper::read( in, d_pair[0] );
+			Helper::read( in + 4, d_pair[1] );
+		}else
+		{
+			Helper::read( in, d_pair[1] );
+			Helper::read( in + 4, d_pair[0] );
+		}
+		break;
+	case TypeTimeSlot:
+		{
+			quint16 v;
+			Helper::read( in, v );
+			d_pair[0] = v;
+			Helper::read( in + 2, v );
+			d_pair[1] = v;
+		}
+		break;
+	case TypeTag:
+		::memcpy( d_buf, in, NameTag::Size );
+		break;
+	default:
+		return false;
+	}
+	return true;
 }
 
 long DataCell::readCell( QIODevice* in )
 {
 	Q_ASSERT( in != 0 );
 	const Peek cell = peekCell( in );
-	if( in->bytesAvailable() < cell.getCellLength() )
+	if( !cell.isValid() || in->bytesAvailable() < cell.getCellLength() )
 		return -1;
+	if( cell.d_type == LobChunked )
+	{
+		const QByteArray buf = in->read( cell.getCellLength() );
+		return readCell( buf.constData(), buf.size() );
+	}
 	char typeSym[1];
 	in->read( typeSym, 1 );
 	DataType type = symToType( typeSym[0] ); // throws
-	const bool compressed = symIsCompressed( typeSym[0] );
 	if( type < TypeNull || type >= TypeInvalid )
 		throw StreamException( StreamException::InvalidProtocol, "readCell: invalid type" );
-	if( type == FrameName || type == SlotName )
-		type = TypeAtom;
-	else if( type == FrameNameStr || type == SlotNameStr )
-		type = TypeAscii; 
-	else if( type == FrameNameIdx || type == SlotNameIdx )
-		type = TypeId32; 
-	else if( type == FrameNameTag || type == SlotNameTag )
-		type = TypeTag;
+	type = _valueType( type );
 
 	clear(); // lsche this
 	d_type = type;
@@ -1166,121 +1965,347 @@ long DataCell::readCell( QIODevice* in )
 		{
 			quint32 count = 0;
 			Helper::readMultibyte32( in, count );
-			QByteArray str = in->read( count );
-			if( compressed )
-				str = myUncompress( reinterpret_cast<const uchar*>(str.constData()), str.size() );
+			readPayload( typeSym[0], count, in );
+		}	
+		break;
+	case MBYTE64:
+		Helper::readMultibyte64( in, d_uint64 );
+		break;
+	case MBYTE32:
+		Helper::readMultibyte32( in, d_uint32 );
+		break;
+	default:
+		if( len > 0 )
+		{
+			char buf[sizeof(double)];
+			Q_ASSERT( len <= int(sizeof(buf)) );
+			in->read( buf, len );
+			if( !readFixed( typeSym[0], buf ) )
+				throw StreamException( StreamException::IncompleteImplementation,
+					"readCell: type not supported" );
+		}
+	}
+
+	return cell.getCellLength();
+}
 
+bool DataCell::readPayload( quint8 sym, quint32 count, QIODevice* in )
+{
+	const DataType type = _valueType( symToType( sym ) ); // throws
+	const int len = typeByteCount[ type ];
+	if( len != UNISTR && len != CSTRING && len != BINARY )
+		return false;
+	clear(); // lsche this
+	d_type = type;
+	// Komprimierte Werte werden direkt vom Gert entpackt
+	QByteArray str = ( symIsCompressed( sym ) )?Codec::unpack( in, count ):in->read( count ); // throws
+	setPayload( len, str );
+	return true;
+}
+
+bool DataCell::readPayload( quint8 sym, QByteArray& payload )
+{
+	const DataType type = _valueType( symToType( sym ) ); // throws
+	const int len = typeByteCount[ type ];
+	if( symIsCompressed( sym ) || ( len != UNISTR && len != CSTRING && len != BINARY ) )
+		return false;
+	clear(); // lsche this
+	d_type = type;
+	QByteArray str;
+	str.swap( payload );
+	setPayload( len, str );
+	return true;
+}
+
+void DataCell::setPayload( int len, QByteArray& str )
+{
+	if( len == UNISTR )
+	{
+		str.truncate( qstrnlen( str.constData(), str.size() ) );
+		setUtf8( str );
+	}else
+	{
+		if( len == CSTRING )
+			// Da str hier noch nicht shared ist, macht truncate keine Allokationsnderung; also gnstig.
+			str.truncate( _cstrLen( str.constData(), str.size() ) );
+		setArr( str );
+	}
+}
+
+long DataCell::readCell( const char* data, quint32 size )
+{
+	quint32 read, at = 0;
+	const DecodeStatus s = tryReadCell( data, size, read, &at );
+	switch( s )
+	{
+	case DecodeOk:
+	case DecodeCorrupt: // Wie bisher mit leerem Wert
+		return read;
+	case DecodePending:
+		return -1;
+	case DecodeUnsupported:
+		throw StreamException( StreamException::IncompleteImplementation,
+			"readCell: type not supported" );
+	case DecodeMissingCodec:
+		throw StreamException( StreamException::WrongDataFormat,
+							   QString( "Codec: codec 0x%1 not available" ).arg( uint( quint8( data[at] ) ), 0, 16 ) );
+	default:
+		throw StreamException( StreamException::InvalidProtocol, getStatusName( s ) );
+	}
+}
+
+DataCell::DecodeStatus DataCell::tryReadCell( const char* data, quint32 size, quint32& read, quint32* errorAt )
+{
+	Q_ASSERT( data != 0 || size == 0 );
+	read = 0;
+	Peek cell;
+	const DecodeStatus s = tryPeekCell( data, size, cell, errorAt );
+	if( s != DecodeOk )
+		return s;
+	if( size < cell.getCellLength() )
+		return DecodePending;
+	const quint8 sym = data[0];
+	const DataType type = _valueType( cell.d_type );
+	const char* payload = data + cell.getHeaderLength();
+	if( type == LobChunked )
+	{
+		clear(); // lsche this
+		d_type = TypeLob;
+		setArr( _joinChunks( payload, cell.d_len ) );
+		read = cell.getCellLength();
+		return DecodeOk;
+	}
+
+	const int len = typeByteCount[ type ];
+	const bool compressed = symIsCompressed( sym ) && ( len == UNISTR || len == CSTRING || len == BINARY );
+	if( compressed && !Codec::canUnpack( payload, cell.d_len ) )
+	{
+		// Codec oder dessen Wrterbuch fehlt
+		if( errorAt )
+			*errorAt = cell.getHeaderLength() + 4; // Id des Codecs
+		return DecodeMissingCodec;
+	}
+
+	clear(); // lsche this
+	d_type = type;
+	read = cell.getCellLength();
+
+	DecodeStatus res = DecodeOk;
+	switch( len )
+	{
+	case UNISTR:
+	case CSTRING:
+	case BINARY:
+		if( compressed )
+		{
+			QByteArray str = Codec::unpack( payload, cell.d_len ); // wirft nicht, siehe canUnpack
+			if( str.isEmpty() && ( cell.d_len < 4 || ::memcmp( payload, "\0\0\0\0", 4 ) != 0 ) )
+			{
+				// Leer, obwohl die Lnge im Header nicht 0 ist; der Wert bleibt wie bisher leer
+				if( errorAt )
+					*errorAt = cell.getHeaderLength();
+				res = DecodeCorrupt;
+			}
 			if( len == UNISTR )
 			{
-				setStr( QString::fromUtf8( str ) );
+				str.truncate( qstrnlen( str.constData(), str.size() ) );
+				setUtf8( str );
 			}else
 			{
-				assert( len == BINARY || len == CSTRING );
 				if( len == CSTRING )
-				{
-					// Korrigiere hier, dass der gespeicherte String bereits ein Nullzeichen enthlt.
-					if( count > 0 && str[count-1] == char(0) )
-					{
-						// Prfe, ob der String ev. das Opfer von berzhligen Nullzeichen ist, was vor dieser
-						// Fehlerbehebung bei mehrmaligem read/write passieren konnte.
-						if( count > 1 && str[count-2] == char(0) )
-						{
-							count = ::strlen( str ) + 1; 
-							// Das passiert mit frheren DB-Dateien ziemlich hufig.
-							// qWarning( "DataCell::readCell string with more than one terminal null" );
-						}
-						// Da str hier noch nicht shared ist, macht truncate keine Allokationsnderung; also gnstig.
-						str.truncate( count-1 );
-					}
-				}
+					str.truncate( _cstrLen( str.constData(), str.size() ) );
 				setArr( str );
 			}
-		}	
+		}else if( len == UNISTR )
+			setUtf8( payload, qstrnlen( payload, cell.d_len ) );
+		else if( len == CSTRING )
+			setArr( payload, _cstrLen( payload, cell.d_len ) );
+		else
+			setArr( payload, cell.d_len );
 		break;
 	case MBYTE64:
-		Helper::readMultibyte64( in, d_uint64 );
+		Helper::readMultibyte64( payload, d_uint64, cell.d_len );
 		break;
 	case MBYTE32:
-		Helper::readMultibyte32( in, d_uint32 );
+		Helper::readMultibyte32( payload, d_uint32, cell.d_len );
 		break;
 	default:
-		switch( d_type )
+		if( !readFixed( sym, payload ) )
 		{
-		case TypeNull:
-		case TypeTrue:
-		case TypeFalse:
-			break;
-		case TypeAtom:	
-			Helper::read( in, d_uint32 );
-			break;
-		case TypeUInt8:	
-			Helper::read( in, d_uint8 );
-			break;
-		case TypeUInt16:
-			Helper::read( in, d_uint16 );
-			break;
-		case TypeInt32:
-			Helper::read( in, d_int32 );
-			break;
-		case TypeUInt32:
-			Helper::read( in, d_uint32 );
-			break;
-		case TypeInt64:
-			Helper::read( in, d_int64 );
-			break;
-		case TypeUInt64:
-			Helper::read( in, d_uint64 );
-			break;
-		case TypeDouble:
-			Helper::read( in, d_double );
-			break;
-        case TypeFloat:
-			Helper::read( in, d_float );
-			break;
-		case TypeDate:
-			Helper::read( in, d_int32 );
-			break;
-		case TypeTime:
-			Helper::read( in, d_int32 );
-			break;
-		case TypeDateTime:
-            if( typeSym[0] == s_symDateTimeOld )
-            {
-                Helper::read( in, d_pair[0] );
-                Helper::read( in, d_pair[1] );
-            }else
-            {
-                Helper::read( in, d_pair[1] );
-                Helper::read( in, d_pair[0] );
-            }
-			break;
-		case TypeTimeSlot:
-			{
-				quint16 v;
-				Helper::read( in, v );
-				d_pair[0] = v;
-				Helper::read( in, v );
-				d_pair[1] = v;
-			}
-			break;
-		case TypeTag:
-			in->read( (char*)d_buf, NameTag::Size );
-			break;
-		default:
-			throw StreamException( StreamException::IncompleteImplementation,
-				"readCell: type not supported" );
+			clear();
+			read = 0;
+			if( errorAt )
+				*errorAt = 0;
+			return DecodeUnsupported;
 		}
 	}
-
-	return cell.getCellLength();
+	return res;
 }
 
 bool DataCell::readCell( const QByteArray& in )
 {
-	QBuffer buf;
-	buf.buffer() = in;
-	buf.open( QIODevice::ReadOnly );
-	return readCell( &buf ) >= 0;
+	return readCell( in.constData(), in.size() ) >= 0;
+}
+
+bool DataCell::get( QDateTime& v ) const
+{
+	if( d_type != TypeDateTime && d_type != TypeDate && d_type != TypeTime )
+		return false;
+	v = getDateTime();
+	return true;
+}
+
+bool DataCell::get( QUuid& v ) const
+{
+	if( d_type != TypeUuid )
+		return false;
+	v = getUuid();
+	return true;
+}
+
+bool DataCell::get( QString& v ) const
+{
+	if( !isStr() )
+		return false;
+	v = getStr();
+	return true;
+}
+
+bool DataCell::get( QByteArray& v ) const
+{
+	if( !isArr() )
+		return false;
+	v = getArr();
+	return true;
+}
+
+template<class T>
+static inline bool _decodeFixed( DataCell::DataType type, const char* cell, quint32 len, T& v )
+{
+	if( len < 1 + sizeof(T) || DataCell::symToType( cell[0] ) != type )
+		return false;
+	Helper::read( cell + 1, v );
+	return true;
+}
+
+bool DataCell::decode( const char* cell, quint32 len, bool& v )
+{
+	if( len < 1 )
+		return false;
+	const DataType type = symToType( cell[0] );
+	if( type != TypeTrue && type != TypeFalse )
+		return false;
+	v = type == TypeTrue;
+	return true;
+}
+
+bool DataCell::decode( const char* cell, quint32 len, quint8& v )
+{
+	return _decodeFixed( TypeUInt8, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, quint16& v )
+{
+	return _decodeFixed( TypeUInt16, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, qint32& v )
+{
+	return _decodeFixed( TypeInt32, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, quint32& v )
+{
+	return _decodeFixed( TypeUInt32, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, qint64& v )
+{
+	return _decodeFixed( TypeInt64, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, quint64& v )
+{
+	return _decodeFixed( TypeUInt64, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, float& v )
+{
+	return _decodeFixed( TypeFloat, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, double& v )
+{
+	return _decodeFixed( TypeDouble, cell, len, v );
+}
+
+bool DataCell::decode( const char* cell, quint32 len, QDateTime& v )
+{
+	// Hat feste Lnge; der Umweg ber DataCell alloziert hier nicht
+	if( len < 1 )
+		return false;
+	const DataType type = symToType( cell[0] );
+	if( type != TypeDateTime && type != TypeDate && type != TypeTime )
+		return false;
+	DataCell tmp;
+	quint32 read;
+	if( tmp.tryReadCell( cell, len, read ) != DecodeOk )
+		return false;
+	v = tmp.getDateTime();
+	return true;
+}
+
+bool DataCell::decode( const char* cell, quint32 len, QUuid& v )
+{
+	if( len < 1 || symToType( cell[0] ) != TypeUuid )
+		return false;
+	DataCell tmp;
+	quint32 read;
+	if( tmp.tryReadCell( cell, len, read ) != DecodeOk )
+		return false;
+	v = tmp.getUuid();
+	return true;
+}
+
+const char* DataCell::rawPayload( const char* cell, quint32 len, quint32& count )
+{
+	// Nutzdaten einer unkomprimierten, ganz vorhandenen Zelle mit Anzahlfeld; 0..sonst
+	if( len < 1 || symIsCompressed( cell[0] ) )
+		return 0;
+	const int n = Helper::peekMultibyte32( cell + 1, len - 1 );
+	if( n < 0 )
+		return 0;
+	Helper::readMultibyte32( cell + 1, count, n );
+	if( quint64(1) + n + count > len )
+		return 0;
+	return cell + 1 + n;
+}
+
+bool DataCell::decode( const char* cell, quint32 len, QString& v )
+{
+	if( len < 1 || getSymbol( cell[0] ).d_count != UNISTR )
+		return false;
+	quint32 count;
+	const char* str = rawPayload( cell, len, count );
+	if( str == 0 )
+		return false;
+	v = QString::fromUtf8( str, qstrnlen( str, count ) );
+	return true;
+}
+
+bool DataCell::decode( const char* cell, quint32 len, QByteArray& v )
+{
+	if( len < 1 )
+		return false;
+	const int n = getSymbol( cell[0] ).d_count;
+	if( n != CSTRING && n != BINARY )
+		return false;
+	quint32 count;
+	const char* str = rawPayload( cell, len, count );
+	if( str == 0 )
+		return false;
+	v = QByteArray( str, ( n == CSTRING )?_cstrLen( str, count ):count );
+	return true;
 }
 
 QString DataCell::toString(bool strip_markup) const
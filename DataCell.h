@@ -23,12 +23,18 @@
 #include <Stream/NameTag.h>
 #include <Stream/TimeSlot.h>
 #include <Stream/Exceptions.h>
+#include <Stream/Codec.h>
+#include <Stream/Helper.h>
 #include <QString>
 #include <QIODevice>
 #include <QDateTime>
 #include <QUrl>
 #include <QUuid>
 #include <QVariant>
+#include <QVarLengthArray>
+#if __cplusplus >= 201103L
+#include <functional>
+#endif
 #if defined( QT_GUI ) || defined(QT_GUI_LIB)
 #include <QImage>
 #include <QPicture>
@@ -36,6 +42,8 @@
 
 namespace Stream
 {
+	struct _CodePoints;
+
 	class DataCell
 	{
 	public:
@@ -83,6 +91,9 @@ namespace Stream
 			MaxType,
 
 			FrameStart,
+			FrameStartSized, // Wie FrameStart, gefolgt von der Lnge des Frames als quint32
+			FramePacked, // Mit Codec::pack komprimierter Rest eines Frames bis und mit FrameEnd
+			LobChunked, // TypeLob in Stcken: Folge von TypeLob-Zellen, abgeschlossen mit einer leeren
 			FrameName,	// Name ist Atom
 			FrameNameStr,// Name ist ASCII-String
 			FrameNameIdx,// Name ist TypeId32-Index in die implizite Stringtabelle des BML
@@ -100,7 +111,21 @@ namespace Stream
 		static const int BINARY; 
 		static const int MBYTE64;		
 		static const int MBYTE32;		
+		static const int CHUNKED;		
 		static const int typeByteCount[];
+		// Eigenschaften eines Typsymbols, eine Zeile pro Symbol (ohne Kompressionsflag)
+		struct Symbol
+		{
+			enum Name { NoName, OfFrame, OfSlot };
+			quint8 d_type;	// DataType; TypeInvalid..kein gltiges Symbol
+			qint8 d_count;	// Wie typeByteCount: feste Lnge oder UNISTR, CSTRING, BINARY etc.
+			quint8 d_name;	// Name: Symbol ist Name eines Frames, eines Slots oder keiner
+		};
+		static const Symbol symbolTable[];
+		static const Symbol& getSymbol( quint8 sym ) { return symbolTable[ sym & 0x7f ]; }
+		static bool isFrameNameSym( quint8 sym ) { return getSymbol( sym ).d_name == Symbol::OfFrame; }
+		static bool isSlotNameSym( quint8 sym ) { return getSymbol( sym ).d_name == Symbol::OfSlot; }
+		static void test(); // Prft symbolTable gegen typeByteCount und typeToSym
 		static const char* typePrettyName[];
 
         bool isTime() const { return d_type == TypeTime; }
@@ -129,9 +154,8 @@ namespace Stream
 		bool isTag() const { return d_type == TypeTag; }
 		bool isStr() const { return typeByteCount[d_type] == UNISTR; }
 		bool isCStr() const { return typeByteCount[d_type] == CSTRING; }
-		bool isArr() const { return typeByteCount[d_type] == CSTRING || 
-			typeByteCount[d_type] == BINARY; }
-		int getByteCount();
+		bool isArr() const { const int n = typeByteCount[d_type]; return n == CSTRING || n == BINARY; }
+		int getByteCount() const;
 
 
 		DataCell& setTag( const NameTag& );
@@ -285,8 +309,46 @@ namespace Stream
 
 		// NOTE: setter geben DataCell& zurck, damit DataCell().setXY(..) als Parameter funktioniert.
 
+		// Gelesene UNISTR-Werte bleiben UTF-8, damit writeCell sie unverndert zurckschreibt.
+		// getStr dekodiert sie bei jedem Aufruf, da ein const DataCell von mehreren Threads
+		// gelesen werden darf; wer den String mehrmals braucht, behlt das Ergebnis oder ruft
+		// einmal decodeStr auf. Dasselbe gilt fr toString und toVariant.
 		QString getStr() const;
 		QByteArray getArr() const;
+		QByteArray getUtf8() const; // Nur UNISTR; die gelesenen Bytes ohne Umweg ber QString
+		void decodeStr(); // Nur UNISTR; ersetzt die UTF-8-Bytes durch den dekodierten QString
+
+		// Wie die get-Methoden, aber mit Typprfung: false..anderer Typ, v bleibt unverndert.
+		// bool..TypeTrue und TypeFalse, quint64..TypeUInt64 (nicht OID oder Id64), QString..UNISTR,
+		// QByteArray..CSTRING und BINARY, QDateTime..wie getDateTime; sonst genau der Typ.
+		bool get( bool& v ) const { if( !isBool() ) return false; v = isTrue(); return true; }
+		bool get( quint8& v ) const { return getIf( TypeUInt8, d_uint8, v ); }
+		bool get( quint16& v ) const { return getIf( TypeUInt16, d_uint16, v ); }
+		bool get( qint32& v ) const { return getIf( TypeInt32, d_int32, v ); }
+		bool get( quint32& v ) const { return getIf( TypeUInt32, d_uint32, v ); }
+		bool get( qint64& v ) const { return getIf( TypeInt64, d_int64, v ); }
+		bool get( quint64& v ) const { return getIf( TypeUInt64, d_uint64, v ); }
+		bool get( float& v ) const { return getIf( TypeFloat, d_float, v ); }
+		bool get( double& v ) const { return getIf( TypeDouble, d_double, v ); }
+		bool get( QDateTime& ) const;
+		bool get( QUuid& ) const;
+		bool get( QString& ) const;
+		bool get( QByteArray& ) const;
+		// Dasselbe direkt ab einer ganzen Zelle im Speicher, ohne DataCell (siehe DataReader::read).
+		// false auch bei komprimierter oder unvollstndiger Zelle.
+		static bool decode( const char* cell, quint32 len, bool& );
+		static bool decode( const char* cell, quint32 len, quint8& );
+		static bool decode( const char* cell, quint32 len, quint16& );
+		static bool decode( const char* cell, quint32 len, qint32& );
+		static bool decode( const char* cell, quint32 len, quint32& );
+		static bool decode( const char* cell, quint32 len, qint64& );
+		static bool decode( const char* cell, quint32 len, quint64& );
+		static bool decode( const char* cell, quint32 len, float& );
+		static bool decode( const char* cell, quint32 len, double& );
+		static bool decode( const char* cell, quint32 len, QDateTime& );
+		static bool decode( const char* cell, quint32 len, QUuid& );
+		static bool decode( const char* cell, quint32 len, QString& );
+		static bool decode( const char* cell, quint32 len, QByteArray& );
 
 		// Konvertierungstroutinen
 		QString toPrettyString() const;
@@ -299,24 +361,52 @@ namespace Stream
 		void assign( const DataCell& rhs );
 		bool equals( const DataCell& rhs ) const;
 		bool operator==( const DataCell& rhs ) const { return equals( rhs ); }
+		bool operator!=( const DataCell& rhs ) const { return !equals( rhs ); }
+		// Totale Ordnung ber alle Typen: Invalid, Null, false, true, Zahlen, dann die brigen
+		// Typen nach Typsymbol. Zahlen werden typbergreifend nach ihrem Wert verglichen, bei
+		// gleichem Wert nach Typ. compare() == 0 genau dann, wenn equals(). Alloziert nicht.
+		int compare( const DataCell& rhs ) const; // <0, 0, >0
+		bool operator<( const DataCell& rhs ) const { return compare( rhs ) < 0; }
+		// Passt zu equals(); UNISTR ergibt als UTF-8 und als QString denselben Wert. Alloziert nicht.
+		uint hash( uint seed = 0 ) const;
 
 		void clear();
 		DataType getType() const { return (DataType)d_type; }
 		QByteArray getTypeName() const { return typePrettyName[d_type]; }
 
-		DataCell():d_type( TypeInvalid ) { d_uint64 = 0; }
-		DataCell( const DataCell& rhs ):d_type( TypeInvalid ) { d_uint64 = 0; assign( rhs ); }
+		DataCell():d_type( TypeInvalid ),d_inline( 0 ),d_utf8( false ) { d_uint64 = 0; }
+		DataCell( const DataCell& rhs ):d_type( TypeInvalid ),d_inline( 0 ),d_utf8( false ) { d_uint64 = 0; assign( rhs ); }
 		~DataCell() { clear(); }
 
-		static DataType symToType( quint8 sym );
+		static DataType symToType( quint8 sym ) { return DataType( getSymbol( sym ).d_type ); }
 		static bool symIsCompressed( quint8 sym );
 		static quint8 typeToSym( DataType );
 		// dataOnly..ohne type und len
 		// compressed..Wert wird komprimiert gespeichert (nur Strings und Binaries und > 64)
-		void writeCell( QIODevice*, bool dataOnly = false, bool compressed = false ) const; 
-		QByteArray writeCell( bool dataOnly = false, bool compressed = false ) const; // Abgekrzte Version mit Buffer
+		// codec..Codec::Id; ist er nicht verfgbar, wird unkomprimiert geschrieben
+		// dict..Wrterbuch-Id des Codecs oder 0; mit Wrterbuch werden auch kurze Werte komprimiert
+		void writeCell( QIODevice*, bool dataOnly = false, bool compressed = false,
+						quint8 codec = Codec::Zlib, quint32 dict = 0 ) const;
+		void writeCell( QByteArray&, bool dataOnly = false, bool compressed = false,
+						quint8 codec = Codec::Zlib, quint32 dict = 0 ) const; // Hngt an
+		QByteArray writeCell( bool dataOnly = false, bool compressed = false,
+							  quint8 codec = Codec::Zlib, quint32 dict = 0 ) const; // Abgekrzte Version mit Buffer
 		long readCell( QIODevice* ); // returns read or -1
-		bool readCell( const QByteArray& ); // Abgekrzte Version mit Buffer; true..ok
+		bool readCell( const QByteArray& ); // Abgekrzte Version ohne Buffer; true..ok
+		long readCell( const char* data, quint32 len ); // Liest direkt ab Speicher; returns read or -1
+		// Liest die count Bytes Nutzdaten eines UNISTR-, CSTRING- oder BINARY-Werts, dessen Typsymbol
+		// und Anzahlfeld schon gelesen sind; false..anderer Typ
+		bool readPayload( quint8 sym, quint32 count, QIODevice* );
+		// Dasselbe mit den bereits gelesenen, unkomprimierten Nutzdaten; payload wird ohne Kopie
+		// bernommen und ist danach leer
+		bool readPayload( quint8 sym, QByteArray& payload );
+		static QByteArray uncompress( const char* data, quint32 len ); // Komprimierte Nutzdaten einer Zelle
+		// Hngt den Wert als Schlssel an out an, dessen memcmp-Reihenfolge der Reihenfolge der
+		// Werte entspricht (Zahlen vorzeichenrichtig, Strings und Binaries bytewise, Typen nach
+		// Typsymbol). Schlssel sind selbstbegrenzend und knnen aneinandergehngt werden (siehe
+		// KeyBuilder). descending..umgekehrte Reihenfolge. Nicht umkehrbar; nur zum Vergleichen.
+		void writeKey( QByteArray& out, bool descending = false ) const;
+		QByteArray toKey( bool descending = false ) const;
 
 		struct Peek
 		{
@@ -329,12 +419,91 @@ namespace Stream
 			quint32 d_len; // Lnge der Daten
 		};
 		static Peek peekCell( QIODevice*); 
+		static Peek peekCell( const char* data, quint32 len );
+
+		// Variante von peekCell und readCell ab Speicher ohne Exceptions, fr nicht vertrauenswrdige
+		// oder beschdigte Daten. errorAt..Offset ab data, an dem der Fehler erkannt wurde.
+		// peekCell und readCell sind Wrapper darum und werfen wie bisher.
+		enum DecodeStatus {
+			DecodeOk,
+			DecodePending,		// Es fehlen noch Bytes
+			DecodeInvalidType,	// Unbekanntes Typsymbol
+			DecodeInvalidChunk,	// Stck eines LobChunked ist kein TypeLob
+			DecodeUnsupported,	// Typ kann nicht als Wert gelesen werden (z.B. FrameStart)
+			DecodeMissingCodec,	// Codec der komprimierten Zelle oder dessen Wrterbuch ist nicht verfgbar
+			DecodeCorrupt,		// Komprimierte Nutzdaten beschdigt; Zelle gelesen, Wert ist leer
+			DecodeTruncated,	// Nur readFrom: Daten enden innerhalb der Zelle
+			DecodeInvalidCell	// Nur readFrom: Header ungltig oder Wert zu gross fr den Speicher
+		};
+		static DecodeStatus tryPeekCell( const char* data, quint32 len, Peek&, quint32* errorAt = 0 );
+		DecodeStatus tryReadCell( const char* data, quint32 len, quint32& read, quint32* errorAt = 0 ); // read..Lnge der Zelle
+		static const char* getStatusName( DecodeStatus );
+		// Lesen und Schreiben ber eine Source bzw. Sink (siehe IoPolicy.h). Liefert die Source
+		// die Daten am Stck, wird direkt mit tryReadCell dekodiert; bei DecodePending ist nichts
+		// konsumiert. Sonst werden Werte fester Lnge mit den Primitiven der Source gelesen, bei
+		// den brigen Typen der Header byteweise und der Rest der Zelle (bzw. jedes Stck eines
+		// LobChunked) in begrenzten Schritten. DecodePending heisst dann, dass die Source vor der
+		// Zelle endet; endet sie darin, ist das Resultat DecodeTruncated. Gelesene Bytes sind
+		// auch bei einem Fehler konsumiert, ein erneuter Versuch ist nicht mglich.
+		// writeTo schreibt Werte fester Lnge und Multibyte mit den Primitiven der Sink; Strings
+		// und Arrays werden wie in writeCell aufbereitet, bei Bedarf komprimiert, und als Ganzes
+		// geschrieben.
+		template<class Source>
+		DecodeStatus readFrom( Source& );
+		template<class Sink>
+		void writeTo( Sink&, bool dataOnly = false, bool compressed = false,
+					  quint8 codec = Codec::Zlib, quint32 dict = 0 ) const;
 
 		static bool checkAscii( const char* );
         static QString stripMarkup( const QString&, bool interpreteMarkup = true );
 	private:
+		template<class T>
+		bool getIf( DataType type, const T& src, T& v ) const
+		{
+			if( d_type != type )
+				return false;
+			v = src;
+			return true;
+		}
+		static const char* rawPayload( const char* cell, quint32 len, quint32& count );
 		void setStr( const QString& );
 		void setArr( const QByteArray& ); 
+		void setArr( const char*, quint32 len );
+		void setUtf8( const QByteArray& );
+		void setUtf8( const char*, quint32 len );
+		void setPayload( int len, QByteArray& );
+		// Wert liegt als Bytes vor (CSTRING, BINARY oder UNISTR als UTF-8)
+		bool hasBytes() const { const int n = typeByteCount[d_type]; return n == BINARY || n == CSTRING || ( n == UNISTR && d_utf8 ); }
+		const char* rawArr( quint32& len ) const; // Bytes von hasBytes() ohne Kopie
+		const char* rawBytes( quint32& len ) const // Wie rawArr, aber hasBytes() ist bekannt
+		{
+			if( d_inline != NotInline )
+			{
+				len = d_inline;
+				return (const char*)d_buf;
+			}
+			const QByteArray* ba = (const QByteArray*) d_buf;
+			len = ba->size();
+			return ba->constData();
+		}
+		_CodePoints codePoints() const; // Nur UNISTR
+		static int compareText( const DataCell&, const DataCell& ); // Nur UNISTR
+		bool readFixed( quint8 sym, const char* ); // false..Typ nicht untersttzt
+		template<class Source>
+		static DecodeStatus readHead( Source&, char* head, quint32& len, Peek& );
+		template<class Source>
+		static DecodeStatus readBounded( Source&, QByteArray& out, quint64 count );
+		template<class Sink>
+		void writeFixed( Sink&, bool dataOnly ) const; // Alle Typen ausser UNISTR, CSTRING und BINARY
+		// Kurze CSTRING- und BINARY-Werte (z.B. Namen) werden direkt in d_buf statt in einem
+		// QByteArray gespeichert, um Allokation und Referenzzhlung zu sparen. Per Default passen
+		// 8 Bytes hinein und die Zelle bleibt so gross wie bisher. Mit STREAM_CELL_INLINE16
+		// passen auch UUIDs und Namen bis 16 Bytes hinein; jede Zelle wird dafr 8 Bytes grsser.
+#ifdef STREAM_CELL_INLINE16
+		enum { InlineSize = 16, NotInline = 0xff };
+#else
+		enum { InlineSize = 8, NotInline = 0xff };
+#endif
 		union
 		{
 			quint8 d_uint8;
@@ -345,13 +514,230 @@ namespace Stream
 			qint64 d_int64;
 			double d_double;
             float d_float;
-			quint8 d_buf[ sizeof(double) ];
+			quint8 d_buf[ InlineSize ];
 			quint32 d_pair[2]; // z.B. fr DateTime
 		};
 
 		quint8 d_type;
+		quint8 d_inline; // Anzahl Bytes in d_buf bei hasBytes() oder NotInline
+		// UNISTR wird beim Lesen als UTF-8 behalten und erst in getStr() dekodiert; writeCell
+		// schreibt die Bytes unverndert zurck.
+		bool d_utf8;
+	};
+
+	template<class Source>
+	DataCell::DecodeStatus DataCell::readFrom( Source& in )
+	{
+		quint64 avail;
+		const char* data = in.direct( avail );
+		if( data != 0 )
+		{
+			quint32 read = 0;
+			const DecodeStatus res = tryReadCell( data, ( avail > 0xffffffff )?0xffffffff:quint32(avail), read );
+			if( res == DecodeOk || res == DecodeCorrupt )
+				in.skip( read );
+			return res;
+		}
+
+		char head[1 + Helper::multiByte64MaxLen];
+		if( !in.getChar( head[0] ) )
+			return DecodePending;
+		// Ab hier sind Bytes konsumiert; fehlen weitere, ist das ein Fehler (DecodeTruncated)
+		const Symbol& s = getSymbol( head[0] );
+		if( s.d_type == TypeInvalid )
+			return DecodeInvalidType;
+		quint32 len;
+		DecodeStatus res;
+		if( s.d_type == LobChunked )
+		{
+			QByteArray lob;
+			Peek chunk;
+			do
+			{
+				if( !in.getChar( head[0] ) )
+					return DecodeTruncated;
+				if( symToType( head[0] ) != TypeLob )
+					return DecodeInvalidChunk;
+				if( ( res = readHead( in, head, len, chunk ) ) != DecodeOk ||
+					( res = readBounded( in, lob, chunk.d_len ) ) != DecodeOk )
+					return res;
+			}while( chunk.d_len != 0 );
+			clear(); // lsche this
+			d_type = TypeLob;
+			setArr( lob );
+			return DecodeOk;
+		}
+
+		if( s.d_count >= 0 && s.d_type < MaxType )
+		{
+			// Feste Lnge: kein Peek ntig
+			char buf[8];
+			if( in.read( buf, s.d_count ) != s.d_count )
+				return DecodeTruncated;
+			clear(); // lsche this
+			d_type = s.d_type;
+			if( !readFixed( head[0], buf ) )
+			{
+				clear();
+				return DecodeUnsupported;
+			}
+			return DecodeOk;
+		}
+
+		Peek cell;
+		if( ( res = readHead( in, head, len, cell ) ) != DecodeOk )
+			return res;
+		QByteArray buf( head, len );
+		if( ( res = readBounded( in, buf, quint64( cell.getHeaderLength() ) + cell.d_len - len ) ) != DecodeOk )
+			return res;
+		quint32 read;
+		return tryReadCell( buf.constData(), buf.size(), read );
+	}
+
+	template<class Source>
+	DataCell::DecodeStatus DataCell::readHead( Source& in, char* head, quint32& len, Peek& cell )
+	{
+		// head[0] ist gelesen; der Rest des Headers wird byteweise gelesen
+		len = 1;
+		DecodeStatus res;
+		while( ( res = tryPeekCell( head, len, cell ) ) == DecodePending )
+		{
+			if( len >= 1 + Helper::multiByte64MaxLen )
+				return DecodeInvalidCell;
+			if( !in.getChar( head[len] ) )
+				return DecodeTruncated;
+			len++;
+		}
+		return res;
+	}
+
+	template<class Source>
+	DataCell::DecodeStatus DataCell::readBounded( Source& in, QByteArray& out, quint64 count )
+	{
+		// Die Lnge stammt aus dem Header; out wchst darum stckweise und nur um die
+		// tatschlich gelesenen Bytes. Ein QByteArray fasst weniger als 2 GB.
+		if( quint64( out.size() ) + count >= 0x7fffffff )
+			return DecodeInvalidCell;
+		while( count > 0 )
+		{
+			const int n = ( count < 0x10000 )?int(count):0x10000;
+			const int old = out.size();
+			out.resize( old + n );
+			const qint64 r = in.read( out.data() + old, n );
+			if( r != n )
+			{
+				out.resize( old + ( ( r > 0 )?int(r):0 ) );
+				return DecodeTruncated;
+			}
+			count -= n;
+		}
+		return DecodeOk;
+	}
+
+	template<class Sink>
+	void DataCell::writeTo( Sink& out, bool dataOnly, bool compressed, quint8 codec, quint32 dict ) const
+	{
+		const int n = typeByteCount[d_type];
+		if( n != UNISTR && n != CSTRING && n != BINARY )
+		{
+			writeFixed( out, dataOnly );
+			return;
+		}
+		QByteArray* buf = out.direct();
+		if( buf != 0 )
+			writeCell( *buf, dataOnly, compressed, codec, dict );
+		else
+		{
+			const QByteArray tmp = writeCell( dataOnly, compressed, codec, dict );
+			out.write( tmp.constData(), tmp.size() );
+		}
+	}
+
+	template<class Sink>
+	void DataCell::writeFixed( Sink& out, bool dataOnly ) const
+	{
+		// Falls dataOnly==true, werden die Daten ohne Typ geschrieben; siehe writeCell.
+		const DataType t = getType();
+		if( !dataOnly )
+			out.putChar( char( typeToSym( t ) ) );
+		switch( t )
+		{
+		case TypeNull:
+		case TypeFalse:
+			if( dataOnly )
+				out.putChar( 0 );
+			break;
+		case TypeTrue:
+			if( dataOnly )
+				out.putChar( 1 );
+			break;
+		case TypeAtom:
+		case TypeUInt32:
+			Helper::put( out, d_uint32 );
+			break;
+		case TypeOid:
+		case TypeRid:
+		case TypeId64:
+			Helper::putMultibyte64( out, d_uint64 );
+			break;
+		case TypeSid:
+		case TypeId32:
+			Helper::putMultibyte32( out, d_uint32 );
+			break;
+		case TypeUInt8:
+			Helper::put( out, d_uint8 );
+			break;
+		case TypeUInt16:
+			Helper::put( out, d_uint16 );
+			break;
+		case TypeInt32:
+		case TypeDate:
+		case TypeTime:
+			Helper::put( out, d_int32 );
+			break;
+		case TypeInt64:
+			Helper::put( out, d_int64 );
+			break;
+		case TypeUInt64:
+			Helper::put( out, d_uint64 );
+			break;
+		case TypeDouble:
+			Helper::put( out, d_double );
+			break;
+		case TypeFloat:
+			Helper::put( out, d_float );
+			break;
+		case TypeDateTime:
+			// s_symDateTimeNew: zuerst das Datum, dann die Zeit
+			Helper::put( out, d_pair[1] );
+			Helper::put( out, d_pair[0] );
+			break;
+		case TypeTimeSlot:
+			Helper::put( out, quint16( d_pair[0] ) );
+			Helper::put( out, quint16( d_pair[1] ) );
+			break;
+		case TypeTag:
+			// Schreibt die Lnge nicht
+			out.write( (const char*)d_buf, NameTag::Size );
+			break;
+		default:
+			throw StreamException( StreamException::IncompleteImplementation,
+				"writeCell: type not supported" );
+		}
+	}
+
+	inline uint qHash( const DataCell& v, uint seed = 0 ) { return v.hash( seed ); }
+}
+
+#if __cplusplus >= 201103L
+namespace std
+{
+	template<> struct hash<Stream::DataCell>
+	{
+		size_t operator()( const Stream::DataCell& v ) const { return v.hash(); }
 	};
 }
+#endif
 
 #if defined( QT_GUI ) || defined(QT_GUI_LIB)
 Q_DECLARE_METATYPE( QPicture )
@@ -24,14 +24,40 @@
 #include <QtDebug>
 using namespace Stream;
 
+class DataReader::LobDevice : public QIODevice
+{
+public:
+	LobDevice( DataReader* r ):d_reader( r ) {}
+	bool isSequential() const { return true; }
+	bool atEnd() const { return d_reader->d_state != SlotLob; }
+	qint64 bytesAvailable() const
+	{
+		if( d_reader->d_state != SlotLob )
+			return 0;
+		return qMin( qint64(d_reader->d_need), d_reader->d_in->bytesAvailable() );
+	}
+protected:
+	qint64 readData( char* data, qint64 maxlen )
+	{
+		if( d_reader->d_state != SlotLob )
+			return -1; // Ende des LOB
+		return d_reader->readLob( data, maxlen );
+	}
+	qint64 writeData( const char*, qint64 ) { return -1; }
+private:
+	DataReader* d_reader;
+};
+
 DataReader::DataReader( const QIODevice* d, bool owner ):
-	d_state( Idle ), d_level( 0 ), d_owner( owner ), d_lastToken( Pending ), d_peeking(false)
+	d_state( Idle ), d_level( 0 ), d_owner( owner ), d_lastToken( Pending ), d_peeking(false), d_lazy(false), d_varint(0), d_skipping(0), d_outerOwner(0),
+	d_need(0), d_skip(0), d_outer(0), d_packedNames(0), d_packedEnds(0), d_lob(0), d_nameIdx(-1)
 {
 	d_in = const_cast<QIODevice*>( d );
 }
 
 DataReader::DataReader( const QByteArray& in ):
-	d_state( Idle ),d_level( 0 ), d_owner( true ), d_lastToken( Pending ), d_peeking(false)
+	d_state( Idle ),d_level( 0 ), d_owner( true ), d_lastToken( Pending ), d_peeking(false), d_lazy(false), d_varint(0), d_skipping(0), d_outerOwner(0),
+	d_need(0), d_skip(0), d_outer(0), d_packedNames(0), d_packedEnds(0), d_lob(0), d_nameIdx(-1)
 {
 	QBuffer* buf = new QBuffer();
 	buf->buffer() = in;
@@ -39,7 +65,8 @@ DataReader::DataReader( const QByteArray& in ):
 }
 
 DataReader::DataReader( const DataCell& bml ):
-	d_state( Idle ),d_level( 0 ), d_owner( true ), d_lastToken( Pending ), d_peeking(false)
+	d_state( Idle ),d_level( 0 ), d_owner( true ), d_lastToken( Pending ), d_peeking(false), d_lazy(false), d_varint(0), d_skipping(0), d_outerOwner(0),
+	d_need(0), d_skip(0), d_outer(0), d_packedNames(0), d_packedEnds(0), d_lob(0), d_nameIdx(-1)
 {
 	// Erzeuge in jedem Fall QBuffer, auch wenn bml Null ist.
 	QBuffer* buf = new QBuffer();
@@ -50,12 +77,17 @@ DataReader::DataReader( const DataCell& bml ):
 
 DataReader::~DataReader()
 {
+	delete d_lob;
+	if( d_outer )
+		leavePacked();
 	if( d_in && d_owner )
 		delete d_in;
 }
 
 void DataReader::setDevice( const QIODevice* in, bool owner )
 {
+	if( d_outer )
+		leavePacked();
 	if( d_in && d_owner )
 		delete d_in;
 	d_in = const_cast<QIODevice*>( in );
@@ -64,202 +96,394 @@ void DataReader::setDevice( const QIODevice* in, bool owner )
 	d_lastToken = Pending;
 	d_peeking = false;
 	d_level = 0;
+	d_varint = 0;
+	d_skipping = 0;
+	d_need = 0;
+	d_skip = 0;
+	d_cell.clear();
+	d_payload.clear();
+	d_lobData.clear();
+	d_ends.clear();
+	d_scopes.clear();
 }
 
 bool DataReader::hasMoreData() const
 {
-	return d_in && d_in->bytesAvailable() > 0;
+	return d_in && ( !d_cell.isEmpty() || d_in->bytesAvailable() > 0 );
 }
 
 void DataReader::fetchNext()
 {
 	open();
+	d_lastToken = Pending;
 
-	char buf[sizeof(double)];
-
-	// Schaue, was als nchstes kommt
-	// Wir bentigen mindestens den DataType
-	switch( d_in->peek( buf, 1 ) )
-	{
-	case 0:
-		d_lastToken = Pending;
-		return;
-    case -1: // d_in ist nicht lesbar
-		throw StreamException( StreamException::DeviceAccess );
-	}
-
-	DataCell::DataType type = DataCell::symToType( buf[0] ); // throws
-
-	if( d_state == Idle )
+	// Jeder Zustand konsumiert nur so viele Bytes, wie vorhanden sind, und kehrt mit Pending
+	// zurck, wenn welche fehlen. Beim nchsten Aufruf geht es an derselben Stelle weiter.
+	char c;
+	while( true )
 	{
-		// Beginne von neuem
-		if( type == DataCell::FrameStart )
+		switch( d_state )
 		{
-			// Fresse FrameStart, das mit peek oben vorsondiert wurde
-			d_in->read( buf, 1 ); 
-			// Schaue, was als nchstes kommt
-			switch( d_in->peek( buf, 1 ) )
-			{
-			case 0:
-				d_lastToken = Pending;
+		case SlotValueLazy:
+			// Der Wert des letzten Slots wurde nicht abgefragt und wird nun bersprungen.
+			if( !skipValue() )
 				return;
-            case -1: // d_in ist nicht lesbar
-				throw StreamException( StreamException::DeviceAccess );
-			}
-			type = DataCell::symToType( buf[0] );
-			if( type == DataCell::FrameName || 
-				type == DataCell::FrameNameTag ||
-				type == DataCell::FrameNameStr ||
-				type == DataCell::FrameNameIdx )
+			d_cell.clear();
+			d_payload.clear();
+			d_state = Idle;
+			break;
+		case SlotLob:
+			// Der Rest des LOB wird Stck fr Stck bersprungen
+			if( !skipLob() )
+				return;
+			d_lobData.clear();
+			break;
+		case Idle:
+			// Beginne von neuem. Das Typsymbol kann schon in d_cell stehen (siehe FramePending).
+			if( d_cell.isEmpty() )
 			{
-				if( d_name.readCell( d_in ) == -1 )
-				{
-					// Wir haben ein Frame aber noch nicht den ganzen Namen.
-					d_state = FrameNamePending;
-					d_lastToken = Pending;
-					return;
-				}else
+				if( !readByte( c ) )
 				{
-					if( type == DataCell::FrameNameStr )
-						d_names.append( d_name.getArr() );
-					else if( type == DataCell::FrameNameIdx )
-					{
-                        if( int(d_name.getId32()) < d_names.size() )
-							d_name.setLatin1( d_names[d_name.getId32()] );
-					}
-					// Wir haben ein Frame und den Namen
-					d_level++;
-					d_lastToken = BeginFrame;
+					if( d_outer )
+						throw StreamException( StreamException::InvalidProtocol,
+											   "packed frame without FrameEnd" );
 					return;
 				}
+				d_cell.append( c );
+			}
+			switch( DataCell::symToType( d_cell[0] ) ) // throws
+			{
+			case DataCell::FrameStart:
+				d_cell.clear();
+				d_ends.append( -1 );
+				d_scopes.append( -1 );
+				d_state = FramePending;
+				break;
+			case DataCell::FrameStartSized:
+				d_cell.clear();
+				d_need = sizeof(quint32);
+				d_state = FrameLenPending;
+				break;
+			case DataCell::FrameEnd:
+				d_cell.clear();
+				endFrame();
+				if( d_outer && d_ends.size() < d_packedEnds )
+					leavePacked(); // Ende des komprimierten Frames
+				d_lastToken = EndFrame;
+				return;
+			case DataCell::FramePacked:
+				beginCell();
+				d_state = PackedPending;
+				break;
+			case DataCell::SlotName:
+			case DataCell::SlotNameTag:
+			case DataCell::SlotNameStr:
+			case DataCell::SlotNameIdx:
+				beginCell();
+				d_state = SlotNamePending;
+				break;
+			default:
+				// Wir haben einen Slot entdeckt ohne Namen
+				d_name.setNull();
+				d_nameIdx = -1;
+				beginCell();
+				d_state = SlotPeekPending;
+				break;
+			}
+			break;
+		case FrameLenPending:
+			if( !readPayload() )
+				return;
+			{
+				quint32 len;
+				Helper::read( d_cell.constData(), len );
+				qint64 end = -1;
+				if( len != 0 && !d_in->isSequential() ) // 0..Lnge unbekannt
+					end = d_in->pos() + len;
+				d_ends.append( end );
+				// Namen aus einem Frame mit Lnge gelten wie beim Writer nur darin; der
+				// Zhler wird nach dem Namen des Frames gesetzt.
+				d_scopes.append( ( len != 0 )?0:-1 );
+			}
+			d_cell.clear();
+			d_state = FramePending;
+			break;
+		case FramePending:
+			// Schaue, ob der Frame einen Namen hat
+			if( !readByte( c ) )
+				return;
+			d_cell.append( c );
+			if( DataCell::isFrameNameSym( c ) )
+			{
+				beginCell();
+				d_state = FrameNamePending;
 			}else
 			{
-				// Wir haben ein Frame entdeckt ohne Namen.
+				// Wir haben ein Frame entdeckt ohne Namen; das Byte gehrt zum nchsten Token.
 				d_name.setNull();
+				d_nameIdx = -1;
+				if( !d_scopes.isEmpty() && d_scopes.last() >= 0 )
+					d_scopes.last() = d_names.size();
 				d_level++;
+				d_state = Idle;
 				d_lastToken = BeginFrame;
 				return;
 			}
-		}else if( type == DataCell::FrameEnd )
-		{
-			// Fresse FrameEnd, das mit peek vorsondiert wurde
-			d_in->read( buf, 1 ); 
-			d_level--;
-			d_lastToken = EndFrame;
+			break;
+		case FrameNamePending:
+			if( !fillCell( false ) )
+				return;
+			// Wir haben ein Frame und den Namen
+			readName();
+			if( !d_scopes.isEmpty() && d_scopes.last() >= 0 )
+				d_scopes.last() = d_names.size();
+			d_level++;
+			d_state = Idle;
+			d_lastToken = BeginFrame;
 			return;
-		}else if( type == DataCell::SlotName || 
-				type == DataCell::SlotNameTag ||
-				type == DataCell::SlotNameStr ||
-				type == DataCell::SlotNameIdx )
-		{
-			if( d_name.readCell( d_in ) == -1 )
-			{
-				// Wir haben noch nicht den ganzen Slot-Name.
-				d_lastToken = Pending;
+		case SlotNamePending:
+			if( !fillCell( false ) )
 				return;
-			}
-			if( type == DataCell::SlotNameStr )
-				d_names.append( d_name.getArr() );
-			else if( type == DataCell::SlotNameIdx )
-			{
-                if( int(d_name.getId32()) < d_names.size() )
-					d_name.setLatin1( d_names[d_name.getId32()] );
-			}
-			// Slot-Name gelesen.
-			d_peek = DataCell::peekCell( d_in );
-			if( !d_peek.isValid() )
-			{
-				// Wir wissen noch nichts ber den Slot
-				d_state = SlotPeekPending;
-				d_lastToken = Pending;
+			readName();
+			d_state = SlotPeekPending;
+			break;
+		case SlotPeekPending:
+			if( !fillCell( true ) )
 				return;
-			}
-			d_state = SlotValuePending;
-			if( isValueReady() )
+			if( DataCell::symToType( d_cell[0] ) == DataCell::LobChunked )
 			{
+				// Die Stcke werden erst mit openLob, readValue oder beim berspringen gelesen
+				d_peek = DataCell::Peek();
+				d_peek.d_type = DataCell::LobChunked;
+				d_cell.clear();
+				d_need = 0;
+				d_state = SlotLob;
 				d_lastToken = Slot;
 				return;
-			}else
-			{
-				d_lastToken = Pending;
-				return;
 			}
-		}else
-		{
-			// Wir haben einen Slot entdeckt ohne Namen
-			d_name.setNull();
-			d_peek = DataCell::peekCell( d_in );
-			if( !d_peek.isValid() )
+			// Typ und Lnge des Slots sind bekannt.
+			d_peek = DataCell::peekCell( d_cell.constData(), d_cell.size() );
+			if( d_lazy )
 			{
-				// Wir wissen noch nichts ber den Slot
-				d_lastToken = Pending;
+				d_state = SlotValueLazy;
+				d_skip = d_need;
+				d_lastToken = Slot;
 				return;
 			}
 			d_state = SlotValuePending;
+			break;
+		case SlotValuePending:
 			if( isValueReady() )
-			{
 				d_lastToken = Slot;
+			return;
+		case PackedPending:
+			if( !fillCell( false ) )
 				return;
-			}else
+			if( d_skipping )
 			{
-				d_lastToken = Pending;
+				// Der Rest des Frames inkl. FrameEnd wird bersprungen, ohne ihn zu entpacken
+				d_cell.clear();
+				d_state = Idle;
+				endFrame();
+				d_lastToken = EndFrame;
 				return;
 			}
+			enterPacked();
+			break;
 		}
-	}else if( d_state == FrameNamePending )
+	}
+}
+
+void DataReader::readName()
+{
+	// d_cell enthlt den vollstndigen Namen
+	d_name.readCell( d_cell.constData(), d_cell.size() );
+	const DataCell::DataType type = DataCell::symToType( d_cell[0] );
+	d_cell.clear();
+	d_nameIdx = -1;
+	if( type == DataCell::FrameNameStr || type == DataCell::SlotNameStr )
 	{
-		Q_ASSERT( type == DataCell::FrameName || 
-				type == DataCell::FrameNameTag ||
-				type == DataCell::FrameNameStr ||
-				type == DataCell::FrameNameIdx );
-		if( d_name.readCell( d_in ) == -1 )
-		{
-			// Wir haben ein Frame aber noch nicht den ganzen Namen.
-			d_lastToken = Pending;
-			return;
-		}else
-		{
-			// Wir haben ein Frame und den Namen
-			d_level++;
-			d_state = Idle;
-			d_lastToken = BeginFrame;
-			return;
-		}
-	}else if( d_state == SlotPeekPending )
+		d_nameIdx = d_names.size();
+		d_names.append( d_name.getArr() );
+	}else if( type == DataCell::FrameNameIdx || type == DataCell::SlotNameIdx )
 	{
-		d_peek = DataCell::peekCell( d_in );
-		if( !d_peek.isValid() )
+		if( int(d_name.getId32()) < d_names.size() )
 		{
-			// Wir wissen noch nichts ber den Slot
-			d_lastToken = Pending;
-			return;
+			// Teilt den QByteArray der Tabelle, ohne Allokation
+			d_nameIdx = d_name.getId32();
+			d_name.setLatin1( d_names[d_nameIdx] );
 		}
-		d_state = SlotValuePending;
-		if( isValueReady() )
-		{
-			d_lastToken = Slot;
-			return;
-		}else
+	}
+}
+
+void DataReader::enterPacked()
+{
+	// d_cell enthlt die ganze FramePacked-Zelle
+	if( d_outer )
+		throw StreamException( StreamException::InvalidProtocol, "nested packed frame" );
+	const DataCell::Peek peek = DataCell::peekCell( d_cell.constData(), d_cell.size() );
+	QBuffer* buf = new QBuffer();
+	buf->buffer() = Codec::unpack( d_cell.constData() + peek.getHeaderLength(), peek.d_len ); // throws
+	buf->open( QIODevice::ReadOnly );
+	d_cell.clear();
+	d_outer = d_in;
+	d_outerOwner = d_owner;
+	d_in = buf;
+	d_owner = true;
+	d_packedNames = d_names.size();
+	d_packedEnds = d_ends.size();
+	d_state = Idle;
+}
+
+void DataReader::endFrame()
+{
+	d_level--;
+	if( !d_ends.isEmpty() )
+		d_ends.removeLast();
+	const int names = ( d_scopes.isEmpty() )?-1:d_scopes.takeLast();
+	while( names >= 0 && d_names.size() > names )
+		d_names.removeLast();
+}
+
+void DataReader::leavePacked()
+{
+	delete d_in;
+	d_in = d_outer;
+	d_owner = d_outerOwner;
+	d_outer = 0;
+	// Die im komprimierten Frame definierten Namen gelten wie beim Writer nur darin
+	while( d_names.size() > d_packedNames )
+		d_names.removeLast();
+}
+
+bool DataReader::readByte( char& c ) const
+{
+	// getChar bedient sich ohne read-Overhead direkt aus dem Puffer des Device
+	if( d_in->getChar( &c ) )
+		return true;
+	if( !d_in->isReadable() )
+		throw StreamException( StreamException::DeviceAccess, "cannot read device" );
+	return false;
+}
+
+void DataReader::beginCell() const
+{
+	// d_cell enthlt das Typsymbol einer neuen Zelle
+	const DataCell::DataType type = DataCell::symToType( d_cell[0] ); // throws
+	if( type >= DataCell::TypeInvalid )
+		throw StreamException( StreamException::InvalidProtocol, "invalid type" );
+	const int len = DataCell::typeByteCount[ type ];
+	d_varint = ( len < 0 && len != DataCell::CHUNKED ); // UNISTR, CSTRING, BINARY, MBYTE64 und MBYTE32
+	d_need = ( len < 0 )?0:len;
+}
+
+bool DataReader::fillCell( bool headerOnly ) const
+{
+	// Setzt die Zelle in d_cell fort; true..Header bzw. ganze Zelle vorhanden
+	char c;
+	if( d_cell.isEmpty() )
+	{
+		if( !readByte( c ) )
+			return false;
+		d_cell.append( c );
+		beginCell();
+	}
+	while( d_varint )
+	{
+		if( !readByte( c ) )
+			return false;
+		d_cell.append( c );
+		const int n = d_cell.size() - 1;
+		const int len = DataCell::getSymbol( d_cell[0] ).d_count;
+		const int max = ( len == DataCell::MBYTE64 )?
+			int(Helper::multiByte64MaxLen):int(Helper::multiByte32MaxLen);
+		if( ( c & 0x80 ) == 0 || n == max )
 		{
-			d_lastToken = Pending;
-			return;
+			// Anzahlfeld vollstndig. Bei MBYTE ist es bereits der Wert.
+			d_varint = false;
+			if( len == DataCell::UNISTR || len == DataCell::CSTRING || len == DataCell::BINARY )
+				Helper::readMultibyte32( d_cell.constData() + 1, d_need, n );
 		}
-	}else if( d_state == SlotValuePending )
+	}
+	if( headerOnly )
+		return true;
+	return readPayload();
+}
+
+bool DataReader::readPayload( QByteArray& out ) const
+{
+	// Hngt bis zu d_need Bytes an out an; true..alle vorhanden. d_need stammt aus dem noch
+	// ungeprften Header; out wchst daher nur um die tatschlich verfgbaren Bytes.
+	if( d_need > 0 )
+	{
+		const qint64 n = qMin( qint64(d_need), d_in->bytesAvailable() );
+		if( n <= 0 )
+			return false;
+		const int old = out.size();
+		out.resize( old + n );
+		const qint64 r = d_in->read( out.data() + old, n );
+		if( r < 0 )
+			throw StreamException( StreamException::DeviceAccess, "cannot read device" );
+		out.resize( old + r );
+		d_need -= r;
+	}
+	return d_need == 0;
+}
+
+bool DataReader::isArrPayload() const
+{
+	// Die Nutzdaten eines unkomprimierten Werts vom Typ UNISTR, CSTRING oder BINARY werden in
+	// d_payload statt d_cell gesammelt, damit d_value sie ohne weitere Kopie bernehmen kann.
+	const int len = DataCell::getSymbol( d_cell[0] ).d_count;
+	return ( len == DataCell::UNISTR || len == DataCell::CSTRING || len == DataCell::BINARY ) &&
+		!DataCell::symIsCompressed( d_cell[0] );
+}
+
+bool DataReader::takeValue() const
+{
+	// d_cell enthlt den Header des Werts; liest den Rest und dekodiert nach d_value.
+	// false..es fehlen noch Bytes
+	if( isArrPayload() )
 	{
-		// Mindestens der Type und Counter des Slots sind schon da.
+		if( !readPayload( d_payload ) )
+			return false;
+		d_value.readPayload( d_cell[0], d_payload ); // bernimmt d_payload
+	}else
+	{
+		if( !readPayload() )
+			return false;
+		d_value.readCell( d_cell.constData(), d_cell.size() );
+	}
+	d_cell.clear();
+	d_state = Idle;
+	return true;
+}
 
-		if( isValueReady() )
+bool DataReader::skipValue()
+{
+	while( d_skip > 0 )
+	{
+		const qint64 avail = d_in->bytesAvailable();
+		if( avail <= 0 )
+			return false;
+		const qint64 n = qMin( qint64(d_skip), avail );
+		if( !d_in->isSequential() )
 		{
-			d_lastToken = Slot;
-			return;
+			if( !d_in->seek( d_in->pos() + n ) )
+				throw StreamException( StreamException::DeviceAccess, "cannot seek device" );
+			d_skip -= n;
 		}else
 		{
-			d_lastToken = Pending;
-			return;
+			char buf[512];
+			const qint64 r = d_in->read( buf, qMin( n, qint64(sizeof(buf)) ) );
+			if( r < 0 )
+				throw StreamException( StreamException::DeviceAccess, "cannot read device" );
+			if( r == 0 )
+				return false;
+			d_skip -= r;
 		}
-	}else
-		Q_ASSERT( false );
-	d_lastToken =  Pending;
+	}
+	return true;
 }
 
 DataReader::Token DataReader::nextToken( bool peek )
@@ -295,24 +519,173 @@ DataReader::Token DataReader::nextToken( bool peek )
 
 bool DataReader::readValue( DataCell& value ) const
 {
-	value = d_value;
-	return true;
+	value = readValue();
+	return d_state != SlotValueLazy && d_state != SlotLob;
 }
 
 const DataCell& DataReader::readValue() const
 {
+	if( d_state == SlotLob )
+	{
+		// Ohne openLob wird der LOB als Ganzes gelesen, soweit vorhanden
+		qint64 n;
+		do
+		{
+			const int old = d_lobData.size();
+			d_lobData.resize( old + 0x10000 );
+			n = readLob( d_lobData.data() + old, 0x10000 );
+			d_lobData.resize( old + n );
+		}while( n > 0 );
+		if( d_state == SlotLob )
+			d_value.clear(); // Es fehlen noch Bytes
+		else
+		{
+			d_value.setLob( d_lobData, false );
+			d_lobData.clear();
+		}
+		return d_value;
+	}
+	// Im Lazy-Modus und bei fester Lnge wird der Wert erst hier dekodiert, sofern noch nichts
+	// davon bersprungen wurde.
+	if( d_state == SlotValueLazy && d_skip == d_need )
+	{
+		if( readCompressed() )
+			d_skip = 0;
+		else if( !takeValue() )
+		{
+			d_skip = d_need;
+			d_value.clear(); // Es fehlen noch Bytes
+		}
+	}
 	return d_value;
 }
 
+const char* DataReader::rawValue( quint32& len ) const
+{
+	// Die ganze, noch nicht dekodierte Zelle in d_cell (Lazy-Modus oder feste Lnge); 0..anderer Zustand,
+	// komprimiert, UNISTR, CSTRING oder BINARY (siehe readValue) oder es fehlen noch Bytes
+	if( d_state != SlotValueLazy || d_skip != d_need || DataCell::symIsCompressed( d_cell[0] ) ||
+		isArrPayload() )
+		return 0;
+	if( !readPayload() )
+	{
+		d_skip = d_need;
+		d_value.clear(); // Es fehlen noch Bytes
+		return 0;
+	}
+	len = d_cell.size();
+	return d_cell.constData();
+}
+
+void DataReader::consumeRaw( bool decoded ) const
+{
+	// decoded..die Zelle in d_cell wurde direkt dekodiert; sonst geht sie wie bei readValue
+	// nach d_value
+	if( decoded )
+		d_value.clear();
+	else
+		d_value.readCell( d_cell.constData(), d_cell.size() );
+	d_cell.clear();
+	d_state = Idle;
+}
+
 bool DataReader::isValueReady() const
 {
 	open();
-	if( d_state == SlotValuePending && d_value.readCell( d_in ) >= 0 )
+	if( d_state != SlotValuePending || !fillCell( true ) )
+		return false;
+	if( readCompressed() )
+		return true;
+	if( !isArrPayload() && !DataCell::symIsCompressed( d_cell[0] ) )
 	{
-		d_state = Idle;
+		// Feste Lnge: die ganze Zelle bleibt roh in d_cell, bis readValue oder read sie
+		// dekodiert, wie im Lazy-Modus, aber ohne dass noch Bytes fehlen.
+		if( !readPayload() )
+			return false;
+		d_skip = 0;
+		d_state = SlotValueLazy;
 		return true;
-	}else
+	}
+	return takeValue();
+}
+
+bool DataReader::readCompressed() const
+{
+	// Ein komprimierter Wert, der ganz vorhanden ist, wird direkt vom Gert entpackt, statt
+	// zuerst die Nutzdaten nach d_cell zu kopieren. d_cell enthlt nur den Header.
+	if( d_cell.size() != int(d_peek.getHeaderLength()) || !DataCell::symIsCompressed( d_cell[0] ) ||
+		d_in->bytesAvailable() < d_need )
 		return false;
+	d_value.readPayload( d_cell[0], d_need, d_in ); // throws
+	d_need = 0;
+	d_cell.clear();
+	d_state = Idle;
+	return true;
+}
+
+QIODevice* DataReader::openLob()
+{
+	if( d_state != SlotLob )
+		return 0;
+	if( d_lob == 0 )
+		d_lob = new LobDevice( this );
+	if( !d_lob->isOpen() )
+		d_lob->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+	return d_lob;
+}
+
+bool DataReader::nextChunk() const
+{
+	// Liest den Header des nchsten Stcks von LobChunked; false..es fehlen noch Bytes
+	if( !fillCell( true ) )
+		return false;
+	if( DataCell::symToType( d_cell[0] ) != DataCell::TypeLob )
+		throw StreamException( StreamException::InvalidProtocol, "invalid LOB chunk" );
+	d_cell.clear();
+	if( d_need == 0 )
+		d_state = Idle; // Ein leeres Stck schliesst ab
+	return true;
+}
+
+qint64 DataReader::readLob( char* data, qint64 maxlen ) const
+{
+	// Liest bis zu maxlen Bytes des LOB, soweit vorhanden
+	qint64 res = 0;
+	while( d_state == SlotLob && res < maxlen )
+	{
+		if( d_need == 0 )
+		{
+			if( !nextChunk() )
+				break;
+			continue;
+		}
+		const qint64 n = d_in->read( data + res, qMin( qint64(d_need), maxlen - res ) );
+		if( n < 0 )
+			throw StreamException( StreamException::DeviceAccess, "cannot read device" );
+		if( n == 0 )
+			break;
+		d_need -= n;
+		res += n;
+	}
+	return res;
+}
+
+bool DataReader::skipLob()
+{
+	while( d_state == SlotLob )
+	{
+		if( d_need > 0 )
+		{
+			d_skip = d_need;
+			const bool done = skipValue();
+			d_need = d_skip;
+			if( !done )
+				return false;
+		}
+		if( !nextChunk() )
+			return false;
+	}
+	return true;
 }
 
 void DataReader::open() const
@@ -403,16 +776,38 @@ QString DataReader::extractString(bool unicodeOnly, bool separateBySpace)
 
 bool DataReader::skipToEndFrame()
 {
+	if( !d_peeking && d_state != FrameLenPending && d_state != FramePending &&
+		d_state != FrameNamePending && !d_ends.isEmpty() && d_ends.last() >= 0 &&
+		( d_outer == 0 || d_ends.size() > d_packedEnds ) && d_ends.last() <= d_in->size() )
+	{
+		// Frame mit Lngenangabe; direkt hinter das zugehrige EndFrame springen
+		if( !d_in->seek( d_ends.last() ) )
+			throw StreamException( StreamException::DeviceAccess, "cannot seek device" );
+		endFrame();
+		d_state = Idle;
+		d_varint = 0;
+		d_need = 0;
+		d_skip = 0;
+		d_cell.clear();
+		d_payload.clear();
+		d_lastToken = EndFrame;
+		return true;
+	}
     const int startLevel = d_level;
+	d_skipping = true;
     Token t = nextToken();
     while( isUseful( t ) )
     {
         if( t == EndFrame )
         {
             if( d_level < startLevel )
+			{
+				d_skipping = false;
                 return true;
+			}
         }
         t = nextToken();
     }
+	d_skipping = false;
     return false;
 }
@@ -21,6 +21,7 @@
 */
 
 #include <Stream/DataCell.h>
+#include <Stream/NameTable.h>
 #include <QList>
 
 namespace Stream
@@ -35,38 +36,127 @@ namespace Stream
 		bool isValueReady() const;
 		bool readValue( DataCell& value ) const; // true..fertig gelesen
 		const DataCell& readValue() const;
-		const DataCell& getValue() const { return d_value; }
+		const DataCell& getValue() const { return readValue(); }
+		// Dekodiert den Wert des aktuellen Slots direkt in v; true..Typ passt, sonst bleibt v
+		// unverndert und der Wert ist weiterhin mit readValue lesbar. Fr T und die Typen siehe
+		// DataCell::get. Unkomprimierte Werte fester Lnge und Multibyte werden in beiden Modi
+		// ohne Umweg ber d_value aus der Zelle dekodiert; passt der Typ, liefert readValue
+		// danach einen ungltigen Wert. QString und QByteArray sowie komprimierte Werte gehen
+		// weiterhin ber d_value; die Nutzdaten werden dabei nicht zustzlich kopiert.
+		// read wirft wie readValue, tryRead nicht.
+		template<class T>
+		bool read( T& v ) const
+		{
+			quint32 len;
+			const char* cell = rawValue( len );
+			if( cell != 0 )
+			{
+				const bool ok = DataCell::decode( cell, len, v );
+				consumeRaw( ok );
+				return ok;
+			}
+			return readValue().get( v );
+		}
+		template<class T>
+		bool tryRead( T& v ) const
+		{
+			try
+			{
+				return read( v );
+			}catch( const StreamException& )
+			{
+				return false;
+			}
+		}
+		// Lazy: nextToken liefert Slot, sobald der Header der Zelle da ist. Der Wert wird erst
+		// mit readValue dekodiert; wird er nicht abgefragt, wird er anhand der Lnge bersprungen.
+		void setLazyValues( bool on ) { d_lazy = on; }
+		bool isLazyValues() const { return d_lazy; }
+		const DataCell::Peek& getPeek() const { return d_peek; } // Typ und Lnge des aktuellen Slots
 		const DataCell& getName() const { return d_name; }
+		// Index eines String-Namens in der Stringtabelle des Streams oder -1. Solange der Name
+		// gilt, ist der Index eindeutig; fr die Namen einer NameTable ist es deren Index.
+		// Damit lassen sich Namen ohne Stringvergleich unterscheiden.
+		int getNameIndex() const { return d_nameIdx; }
+		// Fr einen Slot mit DataCell::LobChunked ein sequentielles Device, das die Stcke direkt
+		// vom Stream liest, ohne den LOB im Speicher zu halten. Gehrt dem Reader und ist bis zum
+		// nchsten nextToken gltig; 0..kein solcher Slot. readValue liest den Rest als TypeLob.
+		QIODevice* openLob();
 		qint16 getLevel() const { return d_level; }
 		void setDevice( const QIODevice*, bool owner = false );
+		// Dieselbe Tabelle wie beim Writer (siehe NameTable); vor dem ersten Token setzen.
+		void setNameTable( const NameTable& t ) { d_names = t.getNames(); }
 		bool hasDevice() const { return d_in != 0; }
 		static bool isUseful( Token t ) { return t >= BeginFrame; }
 		void dump(const QByteArray& title = QByteArray() );
 		QString extractString(bool unicodeOnly = true, bool separateBySpace = true );
 		Token getCurrentToken() const { return Token(d_lastToken); }
-        bool skipToEndFrame(); // Bis und mit EndFrame
+        bool skipToEndFrame(); // Bis und mit EndFrame; FrameStartSized mit seek, FramePacked ohne Entpacken
 
 		DataReader( const QIODevice* = 0, bool owner = false );
 		DataReader( const QByteArray& ); // Variante mit owned QBuffer
 		DataReader( const DataCell& bml );
 		~DataReader();
 	private:
+		class LobDevice;
         DataReader( const DataReader& ) {}
 		DataReader& operator=( const DataReader& ) { return *this; }
 		void open() const;
 		void fetchNext();
+		bool skipValue();
+		void readName();
+		bool readByte( char& ) const;
+		void beginCell() const;
+		bool fillCell( bool headerOnly ) const;
+		bool readPayload() const { return readPayload( d_cell ); }
+		bool readPayload( QByteArray& ) const;
+		bool isArrPayload() const;
+		bool takeValue() const;
+		const char* rawValue( quint32& len ) const;
+		void consumeRaw( bool decoded ) const;
+		bool readCompressed() const;
+		bool nextChunk() const;
+		qint64 readLob( char*, qint64 ) const;
+		bool skipLob();
+		void enterPacked();
+		void leavePacked();
+		void endFrame();
 		QIODevice* d_in;
 		DataCell d_name;
 		mutable DataCell d_value;
-		enum State { Idle, FrameNamePending, SlotPeekPending, SlotValuePending };
-		mutable quint32 d_state : 2;
+		// Der Parser konsumiert jedes Byte genau einmal; angefangene Zellen werden in d_cell
+		// gesammelt und beim nchsten Aufruf fortgesetzt.
+		enum State { Idle, FrameLenPending, FramePending, FrameNamePending, SlotNamePending,
+					 SlotPeekPending, SlotValuePending, SlotValueLazy, PackedPending, SlotLob };
+		mutable quint32 d_state : 4;
 		quint32 d_lastToken : 2;
 		quint32 d_peeking : 1;
 		quint32 d_owner : 1;
+		quint32 d_lazy : 1;
 		qint32 d_level : 16;
-		quint32 dummy : 10;
+		mutable quint32 d_varint : 1; // Anzahlfeld der Zelle in d_cell ist noch unvollstndig
+		quint32 d_skipping : 1; // skipToEndFrame ist aktiv
+		quint32 d_outerOwner : 1;
+		quint32 dummy : 4;
+		mutable quint32 d_need; // Anzahl noch fehlender Bytes der Zelle in d_cell
+		mutable quint32 d_skip; // Anzahl noch zu berspringender Bytes
+		mutable QByteArray d_cell; // Bereits gelesene Bytes der aktuellen Zelle
+		mutable QByteArray d_payload; // Nutzdaten eines Werts mit isArrPayload; d_cell hat nur den Header
 		DataCell::Peek d_peek;
 		QList<QByteArray> d_names;
+		QList<qint64> d_ends; // Pro offenem Frame Gerteposition nach EndFrame oder -1 falls unbekannt
+		QList<int> d_scopes; // Pro offenem Frame Anzahl d_names bei Beginn falls Lnge bekannt, sonst -1
+		// Beim Lesen eines FramePacked ist d_in ein QBuffer mit dem entpackten Inhalt, und
+		// d_outer das eigentliche Device. Namen und Enden ab d_packedNames bzw. d_packedEnds
+		// gehren zum entpackten Inhalt.
+		QIODevice* d_outer;
+		int d_packedNames;
+		int d_packedEnds;
+		// Im Zustand SlotLob ist d_need der Rest des aktuellen Stcks; d_cell enthlt hchstens
+		// einen angefangenen Header.
+		LobDevice* d_lob;
+		mutable QByteArray d_lobData; // Von readValue bereits gelesene Stcke
+		int d_nameIdx;
 
 		// DONT_CREATE_ON_HEAP;
 	};
@@ -23,8 +23,12 @@
 #include <QBuffer>
 using namespace Stream;
 
+static const int s_defaultHighWater = 0; // Wie bisher: jede Zelle wird sofort geschrieben
+static const int s_lobChunk = 64 * 1024; // Grsse der Stcke von writeLob
+
 DataWriter::DataWriter( QIODevice* d, bool owner ):
-	d_out( d ), d_level(0), d_cells(0), d_nulls(0), d_owner( owner )
+	d_out( d ), d_highWater( s_defaultHighWater ), d_pending(0), d_packed(-1), d_packedNames(0), d_packedLevel(0), d_level(0), d_cells(0), d_nulls(0), d_owner( owner ),
+	d_sized( false ), d_codec( Codec::Zlib ), d_dict( 0 )
 {
 	if( d_out == 0 )
 	{
@@ -34,14 +38,16 @@ DataWriter::DataWriter( QIODevice* d, bool owner ):
 }
 
 DataWriter::DataWriter():
-	d_level(0), d_cells(0), d_nulls(0)
+	d_highWater( s_defaultHighWater ), d_pending(0), d_packed(-1), d_packedNames(0), d_packedLevel(0), d_level(0), d_cells(0), d_nulls(0), d_sized( false ),
+	d_codec( Codec::Zlib ), d_dict( 0 )
 {
 	d_out = new QBuffer();
 	d_owner = true;
 }
 
 DataWriter::DataWriter(const DataWriter& rhs):
-	d_level(0), d_cells(0), d_nulls(0)
+	d_highWater( s_defaultHighWater ), d_pending(0), d_packed(-1), d_packedNames(0), d_packedLevel(0), d_level(0), d_cells(0), d_nulls(0), d_sized( false ),
+	d_codec( Codec::Zlib ), d_dict( 0 )
 {
     Q_UNUSED(rhs);
 	d_out = new QBuffer();
@@ -50,6 +56,7 @@ DataWriter::DataWriter(const DataWriter& rhs):
 
 DataWriter::~DataWriter()
 {
+	flushBuffer( true );
 	if( d_out && d_owner )
 	{
 		delete d_out;
@@ -58,6 +65,7 @@ DataWriter::~DataWriter()
 
 void DataWriter::setDevice( QIODevice* out, bool owner )
 {
+	flushBuffer( true );
 	if( d_out && d_owner )
 	{
 		delete d_out;
@@ -72,6 +80,9 @@ void DataWriter::setDevice( QIODevice* out, bool owner )
 	d_level = 0;
 	d_cells = 0;
 	d_nulls = 0;
+	d_frames.clear();
+	d_frameNames.clear();
+	d_pending = 0;
 }
 
 void DataWriter::begin()
@@ -81,31 +92,123 @@ void DataWriter::begin()
 	d_level++;
 }
 
-void DataWriter::startFrame( DataCell::Atom name )
+void DataWriter::writeFrameStart()
 {
-	open();
-	Helper::write( d_out, DataCell::typeToSym( DataCell::FrameStart ) );
+	if( d_sized )
+	{
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameStartSized ) );
+		d_frames.append( d_buf.size() );
+		Helper::write( d_buf, quint32(0) ); // 0..Lnge unbekannt; wird in endFrame nachgetragen
+		d_pending++;
+	}else
+	{
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameStart ) );
+		d_frames.append( -1 );
+	}
 	begin();
+}
+
+void DataWriter::beginBody( bool compress )
+{
+	// Aufgerufen nach dem Namen des Frames; dieser gilt auch nach dem Frame.
+	d_frameNames.append( nameCount() );
+	// Der Inhalt wird zuerst normal in d_buf geschrieben und erst in endPacked ersetzt. Der
+	// Puffer wird solange nicht geschrieben; d_pending hlt ihn zurck wie bei FrameStartSized.
+	if( !compress || d_packed >= 0 )
+		return;
+	d_packed = d_buf.size();
+	d_packedLevel = d_level;
+	d_packedNames = nameCount();
+	d_pending++;
+}
+
+void DataWriter::endPacked()
+{
+	// d_buf enthlt ab d_packed den Inhalt des Frames bis und mit FrameEnd
+	const int body = d_buf.size() - d_packed;
+	const QByteArray packed = Codec::pack( d_codec, d_buf.constData() + d_packed, body, d_dict );
+	if( !packed.isEmpty() && packed.size() + 1 + Helper::multiByte32MaxLen < body )
+	{
+		d_buf.truncate( d_packed );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FramePacked ) );
+		Helper::writeMultibyte32( d_buf, packed.size() );
+		d_buf.append( packed );
+		// Leser, die den Frame berspringen, kennen die darin definierten Namen nicht
+		truncateNames( d_packedNames );
+	}// else unkomprimiert lassen; die darin definierten Namen bleiben gltig
+	d_packed = -1;
+	d_pending--;
+}
+
+void DataWriter::truncateNames( int count )
+{
+	// Die Indizes in d_names sind fortlaufend; entferne alle ab count
+	if( nameCount() <= count )
+		return;
+	QHash<QByteArray,quint32>::iterator i = d_names.begin();
+	while( i != d_names.end() )
+	{
+		if( int(i.value()) >= count )
+			i = d_names.erase( i );
+		else
+			++i;
+	}
+}
+
+void DataWriter::setNameTable( const NameTable& t )
+{
+	// Die im Stream definierten Namen htten mit der neuen Tabelle andere Indizes
+	d_table = t;
+	d_names.clear();
+}
+
+bool DataWriter::findName( const QByteArray& name, quint32& index )
+{
+	// Findet den Namen oder vergibt ihm den nchsten Index; true..bereits bekannt
+	const int t = d_table.indexOf( name );
+	if( t >= 0 )
+	{
+		index = t;
+		return true;
+	}
+	QHash<QByteArray,quint32>::const_iterator i = d_names.constFind( name );
+	if( i != d_names.constEnd() )
+	{
+		index = i.value();
+		return true;
+	}
+	index = nameCount();
+	d_names.insert( QByteArray( name.constData(), name.size() ), index ); // name zeigt evtl. auf fremden Speicher
+	return false;
+}
+
+void DataWriter::startFrame( DataCell::Atom name, bool compress )
+{
+	open();
+	writeFrameStart();
 	if( name != DataCell::null )
 	{
-		Helper::write( d_out, DataCell::typeToSym( DataCell::FrameName ) );
-		Helper::write( d_out, name );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameName ) );
+		Helper::write( d_buf, name );
 	}
+	beginBody( compress );
+	written();
 }
 
-void DataWriter::startFrame( NameTag name )
+void DataWriter::startFrame( NameTag name, bool compress )
 {
 	open();
-	Helper::write( d_out, DataCell::typeToSym( DataCell::FrameStart ) );
-	begin();
+	writeFrameStart();
 	if( !name.isNull() )
 	{
-		Helper::write( d_out, DataCell::typeToSym( DataCell::FrameNameTag ) );
-		d_out->write( name.d_tag, NameTag::Size );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameNameTag ) );
+		d_buf.append( name.d_tag, NameTag::Size );
 	}
+	beginBody( compress );
+	written();
 }
 
-void DataWriter::startFrame( const char* ascii )
+void DataWriter::startFrame( const char* ascii, bool compress )
 {
 	open();
 	/* RISK
@@ -113,24 +216,25 @@ void DataWriter::startFrame( const char* ascii )
 		throw StreamException( StreamException::WrongDataFormat,
 			"startFrame: expecting ascii name" );
 			*/
-	Helper::write( d_out, DataCell::typeToSym( DataCell::FrameStart ) );
-	begin();
-	QByteArray name = ascii;
-	QMap<QByteArray,quint32>::const_iterator i = d_names.find( name );
-	if( i == d_names.end() )
+	writeFrameStart();
+	// Nur zum Nachschlagen, ohne Kopie; findName kopiert den Namen erst beim Eintragen
+	const QByteArray name = QByteArray::fromRawData( ascii, ::strlen( ascii ) );
+	quint32 index;
+	if( !findName( name, index ) )
 	{
 		// Name existiert noch nicht. Sende ihn explizit
-		d_names[name] = d_names.size();
-		Helper::write( d_out, DataCell::typeToSym( DataCell::FrameNameStr ) );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameNameStr ) );
 		// Schreibt zuerst die Lnge
 		const quint32 len = name.size() + 1;
-		Helper::writeMultibyte32( d_out, len );
-		d_out->write( name, len );
+		Helper::writeMultibyte32( d_buf, len );
+		d_buf.append( name.constData(), len );
 	}else
 	{
-		Helper::write( d_out, DataCell::typeToSym( DataCell::FrameNameIdx ) );
-		Helper::writeMultibyte32( d_out, i.value() );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameNameIdx ) );
+		Helper::writeMultibyte32( d_buf, index );
 	}
+	beginBody( compress );
+	written();
 }
 
 void DataWriter::endFrame()
@@ -139,7 +243,20 @@ void DataWriter::endFrame()
 	if( d_level == 0 )
 		return;
 	d_level--;
-	Helper::write( d_out, DataCell::typeToSym( DataCell::FrameEnd ) );
+	Helper::write( d_buf, DataCell::typeToSym( DataCell::FrameEnd ) );
+	if( d_packed >= 0 && d_level + 1 == d_packedLevel )
+		endPacked();
+	const int pos = ( d_frames.isEmpty() )?-1:d_frames.takeLast();
+	const int names = ( d_frameNames.isEmpty() )?0:d_frameNames.takeLast();
+	if( pos >= 0 )
+	{
+		// Lnge ab nach dem Lngenfeld bis und mit FrameEnd
+		Helper::write( d_buf.data() + pos, quint32( d_buf.size() - pos - sizeof(quint32) ) );
+		d_pending--;
+		// Leser, die den Frame berspringen, kennen die darin definierten Namen nicht
+		truncateNames( names );
+	}
+	written();
 }
 
 void DataWriter::writeSlot( const DataCell& v, DataCell::Atom name, bool compress )
@@ -150,18 +267,15 @@ void DataWriter::writeSlot( const DataCell& v, DataCell::Atom name, bool compres
 	//Knftig auch Named-Slots auf Toplevel zulssig
 	//if( d_level == 0 && name != DataCell::null )
 	//	throw Exception( "writeSlot: named slots not allowed on top level" );
-	if( name != DataCell::null )
-	{
-		Helper::write( d_out, DataCell::typeToSym( DataCell::SlotName ) );
-		Helper::write( d_out, name );
-	}
-	v.writeCell( d_out, false, compress );
+	writeSlotName( name );
+	v.writeCell( d_buf, false, compress && d_packed < 0, d_codec, d_dict );
 	if( d_level == 0 )
 	{
 		d_cells++;
 		if( v.isNull() )
 			d_nulls++;
 	}
+	written();
 }
 
 void DataWriter::writeSlot( const DataCell& v, NameTag name, bool compress )
@@ -169,18 +283,15 @@ void DataWriter::writeSlot( const DataCell& v, NameTag name, bool compress )
 	open();
 	if( !v.isValid() )
 		return;
-	if( !name.isNull() )
-	{
-		Helper::write( d_out, DataCell::typeToSym( DataCell::SlotNameTag ) );
-		d_out->write( name.d_tag, NameTag::Size );
-	}
-	v.writeCell( d_out, false, compress );
+	writeSlotName( name );
+	v.writeCell( d_buf, false, compress && d_packed < 0, d_codec, d_dict );
 	if( d_level == 0 )
 	{
 		d_cells++;
 		if( v.isNull() )
 			d_nulls++;
 	}
+	written();
 }
 
 void DataWriter::writeSlot( const DataCell& v, const char* ascii, bool compress )
@@ -194,31 +305,105 @@ void DataWriter::writeSlot( const DataCell& v, const char* ascii, bool compress
 			"startFrame: expecting ascii name" );
 			*/
 
-	QByteArray name = ascii;
-	QMap<QByteArray,quint32>::const_iterator i = d_names.find( name );
-	if( i == d_names.end() )
+	writeSlotName( ascii );
+	v.writeCell( d_buf, false, compress && d_packed < 0, d_codec, d_dict );
+
+	if( d_level == 0 )
+	{
+		d_cells++;
+		if( v.isNull() )
+			d_nulls++;
+	}
+	written();
+}
+
+void DataWriter::writeLob( QIODevice* lob, DataCell::Atom name )
+{
+	open();
+	writeSlotName( name );
+	writeChunks( lob );
+}
+
+void DataWriter::writeLob( QIODevice* lob, NameTag name )
+{
+	open();
+	writeSlotName( name );
+	writeChunks( lob );
+}
+
+void DataWriter::writeLob( QIODevice* lob, const char* ascii )
+{
+	open();
+	writeSlotName( ascii );
+	writeChunks( lob );
+}
+
+void DataWriter::writeSlotName( DataCell::Atom name )
+{
+	if( name != DataCell::null )
+	{
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::SlotName ) );
+		Helper::write( d_buf, name );
+	}
+}
+
+void DataWriter::writeSlotName( NameTag name )
+{
+	if( !name.isNull() )
+	{
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::SlotNameTag ) );
+		d_buf.append( name.d_tag, NameTag::Size );
+	}
+}
+
+void DataWriter::writeSlotName( const char* ascii )
+{
+	// Nur zum Nachschlagen, ohne Kopie; findName kopiert den Namen erst beim Eintragen
+	const QByteArray name = QByteArray::fromRawData( ascii, ::strlen( ascii ) );
+	quint32 index;
+	if( !findName( name, index ) )
 	{
 		// Name existiert noch nicht. Sende ihn explizit
-		d_names[name] = d_names.size();
-		Helper::write( d_out, DataCell::typeToSym( DataCell::SlotNameStr ) );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::SlotNameStr ) );
 		// Schreibt zuerst die Lnge
 		const quint32 len = name.size() + 1;
-		Helper::writeMultibyte32( d_out, len );
-		d_out->write( name, len );
+		Helper::writeMultibyte32( d_buf, len );
+		d_buf.append( name.constData(), len );
 	}else
 	{
 		// Name wurde bereits verwendet. Hier daher Index
-		Helper::write( d_out, DataCell::typeToSym( DataCell::SlotNameIdx ) );
-		Helper::writeMultibyte32( d_out, i.value() );
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::SlotNameIdx ) );
+		Helper::writeMultibyte32( d_buf, index );
 	}
-	v.writeCell( d_out, false, compress );
+}
 
-	if( d_level == 0 )
+void DataWriter::writeChunks( QIODevice* lob )
+{
+	Q_ASSERT( lob != 0 );
+	if( !lob->isOpen() && !lob->open( QIODevice::ReadOnly ) )
+		throw StreamException( StreamException::DeviceAccess, "cannot open LOB for reading" );
+	// Jedes Stck ist eine TypeLob-Zelle; ein leeres schliesst ab. Der Puffer wird wie
+	// gewohnt bei der High-Water-Mark geschrieben, sofern kein Frame eine Lnge braucht.
+	Helper::write( d_buf, DataCell::typeToSym( DataCell::LobChunked ) );
+	while( true )
 	{
-		d_cells++;
-		if( v.isNull() )
-			d_nulls++;
+		const QByteArray chunk = lob->read( s_lobChunk );
+		if( chunk.isEmpty() )
+		{
+			if( !lob->atEnd() && lob->waitForReadyRead( -1 ) )
+				continue;
+			break;
+		}
+		Helper::write( d_buf, DataCell::typeToSym( DataCell::TypeLob ) );
+		Helper::writeMultibyte32( d_buf, chunk.size() );
+		d_buf.append( chunk );
+		written();
 	}
+	Helper::write( d_buf, DataCell::typeToSym( DataCell::TypeLob ) );
+	Helper::writeMultibyte32( d_buf, 0 );
+	if( d_level == 0 )
+		d_cells++;
+	written();
 }
 
 void DataWriter::open()
@@ -233,11 +418,64 @@ void DataWriter::open()
 	}
 }
 
+void DataWriter::flushBuffer( bool force ) const
+{
+	if( d_buf.isEmpty() || d_out == 0 || !d_out->isOpen() )
+		return;
+	if( d_pending > 0 )
+	{
+		if( !force )
+			return; // Es sind noch Lngen nachzutragen
+		// Die Lngen der offenen Frames bleiben 0, d.h. unbekannt, und ein offener
+		// komprimierter Frame wird unkomprimiert geschrieben.
+		for( int i = 0; i < d_frames.size(); i++ )
+			d_frames[i] = -1;
+		d_packed = -1;
+		d_pending = 0;
+	}
+	d_out->write( d_buf );
+	d_buf.clear();
+}
+
+bool DataWriter::flush()
+{
+	if( d_buf.isEmpty() )
+		return true;
+	open();
+	flushBuffer();
+	return d_buf.isEmpty();
+}
+
+void DataWriter::setHighWaterMark( int bytes )
+{
+	d_highWater = qMax( 0, bytes );
+	if( !d_buf.isEmpty() && d_buf.size() >= d_highWater )
+		flush();
+}
+
+void DataWriter::setCodec( quint8 id )
+{
+	if( !Codec::isAvailable( id ) )
+		throw StreamException( StreamException::IncompleteImplementation,
+							   QString( "DataWriter: codec 0x%1 not available" ).arg( id, 0, 16 ) );
+	d_codec = id;
+	d_dict = 0;
+}
+
+void DataWriter::setDictionary( quint32 id )
+{
+	if( id != 0 && !Codec::hasDictionary( d_codec, id ) )
+		throw StreamException( StreamException::IncompleteImplementation,
+							   QString( "DataWriter: dictionary %1 not registered" ).arg( id ) );
+	d_dict = id;
+}
+
 QByteArray DataWriter::getStream() const
 {
 	QBuffer* buf = dynamic_cast<QBuffer*>( d_out );
 	if( buf )
 	{
+		flushBuffer( true );
 		buf->close();
 		return buf->buffer();
 	}else
@@ -21,7 +21,8 @@
 */
 
 #include <Stream/DataCell.h>
-#include <QMap>
+#include <Stream/NameTable.h>
+#include <QHash>
 
 namespace Stream
 {
@@ -40,30 +41,93 @@ namespace Stream
 
 		void setDevice( QIODevice* = 0, bool owner = false ); // 0..QBuffer
 
-		void startFrame( DataCell::Atom name = DataCell::null );
-		void startFrame( NameTag name );
-		void startFrame( const char* ascii ); 
+		// Der Writer sammelt den Output in einem internen Puffer und schreibt ihn erst auf das
+		// Device, wenn der Puffer die High-Water-Mark erreicht, bei flush() oder im Destruktor.
+		// Default ist 0, d.h. jede Zelle wird wie bisher sofort geschrieben; gepuffert wird nur
+		// nach setHighWaterMark. flush liefert false, wenn ein Frame mit Lnge oder ein
+		// komprimierter Frame offen ist; der Puffer wird dann erst nach dessen endFrame geschrieben.
+		bool flush();
+		void setHighWaterMark( int bytes ); // 0..jede Zelle wird sofort geschrieben
+		int getHighWaterMark() const { return d_highWater; }
+
+		// Sized: Frames werden mit FrameStartSized und ihrer Lnge geschrieben, damit Leser sie
+		// in O(1) berspringen knnen. Die Lnge wird bei endFrame im Puffer nachgetragen; solange
+		// ein solcher Frame offen ist, wird der Puffer daher nicht auf das Device geschrieben.
+		// Namen, die in einem Frame mit Lnge erstmals vorkommen, gelten nur in diesem Frame.
+		void setSizedFrames( bool on ) { d_sized = on; }
+		bool isSizedFrames() const { return d_sized; }
+
+		// Codec fr Slots, die mit compress=true geschrieben werden; Default ist Codec::Zlib.
+		// throws, falls der Codec nicht verfgbar ist.
+		void setCodec( quint8 id );
+		quint8 getCodec() const { return d_codec; }
+		// Wrterbuch des Codecs (siehe Codec::registerDictionary); 0..keines. throws, falls
+		// es fr den aktuellen Codec nicht registriert ist. Der Reader findet es ber die Registry.
+		void setDictionary( quint32 id );
+		quint32 getDictionary() const { return d_dict; }
+		// Vorgegebene Namen (siehe NameTable), die schon beim ersten Vorkommen als Index
+		// geschrieben werden. Vor dem ersten Frame bzw. Slot setzen; der Leser braucht dieselbe.
+		void setNameTable( const NameTable& );
+		const NameTable& getNameTable() const { return d_table; }
+
+		// compress..Der ganze Inhalt des Frames wird bei endFrame als eine Einheit mit dem Codec
+		// komprimiert (DataCell::FramePacked). Die Leser entpacken ihn erst, wenn der Frame
+		// betreten und nicht bersprungen wird. In einem solchen Frame werden weder Unterframes
+		// noch einzelne Slots nochmals komprimiert.
+		void startFrame( DataCell::Atom name = DataCell::null, bool compress = false );
+		void startFrame( NameTag name, bool compress = false );
+		void startFrame( const char* ascii, bool compress = false ); 
 		void endFrame();
 		void writeSlot( const DataCell&, DataCell::Atom name = DataCell::null, bool compress = false );
 		void writeSlot( const DataCell&, NameTag name, bool compress = false );
 		void writeSlot( const DataCell&, const char* ascii, bool compress = false ); 
+		// Schreibt den Inhalt des Device als TypeLob in Stcken (DataCell::LobChunked), ohne ihn
+		// ganz im Speicher zu halten. Der DataReader liefert ihn mit openLob wieder als Device.
+		// In einem Frame mit Lnge oder einem komprimierten Frame wird er bis endFrame gepuffert.
+		void writeLob( QIODevice*, DataCell::Atom name = DataCell::null );
+		void writeLob( QIODevice*, NameTag name );
+		void writeLob( QIODevice*, const char* ascii );
 
 		quint16 getLevel() const { return d_level; }
 		quint16 getCells() const { return d_cells; }
 		quint16 getNulls() const { return d_nulls; }
 		bool isNull() const { return d_cells == d_nulls; }
-		QByteArray getStream() const; // Im Falle von QBuffer gebe buffer() zurck.
+		QByteArray getStream() const; // Im Falle von QBuffer gebe buffer() zurck; macht flush.
 		DataCell getBml() const { return DataCell().setBml( getStream() ); }
 	private:
 		void open();
 		void begin();
+		void writeFrameStart();
+		void beginBody( bool compress );
+		void endPacked();
+		void truncateNames( int count );
+		int nameCount() const { return d_table.size() + d_names.size(); }
+		bool findName( const QByteArray&, quint32& index );
+		void writeSlotName( DataCell::Atom );
+		void writeSlotName( NameTag );
+		void writeSlotName( const char* ascii );
+		void writeChunks( QIODevice* );
+		void written() { if( d_buf.size() >= d_highWater ) flushBuffer(); }
+		void flushBuffer( bool force = false ) const;
 		QIODevice* d_out;
-		QMap<QByteArray,quint32> d_names;
+		mutable QByteArray d_buf;
+		int d_highWater;
+		NameTable d_table;
+		QHash<QByteArray,quint32> d_names; // Im Stream definierte Namen; Indizes nach denen in d_table
+		mutable QList<int> d_frames; // Pro offenem Frame Position der Lnge in d_buf oder -1
+		QList<int> d_frameNames; // Pro offenem Frame nameCount() nach dessen Namen
+		mutable quint16 d_pending; // Anzahl offener Frames mit noch nachzutragender Lnge
+		mutable int d_packed; // Position des Inhalts des komprimierten Frames in d_buf oder -1
+		int d_packedNames; // nameCount() vor dem komprimierten Frame
+		quint16 d_packedLevel;
 		quint16 d_level;
 		// RISK: gengen #16bit Cells?
 		quint16 d_cells; // Anzahl Top-Level-Cells
 		quint16 d_nulls; // Anzahl Top-Level-Nulls
 		bool d_owner;
+		bool d_sized;
+		quint8 d_codec;
+		quint32 d_dict;
 
 		// DONT_CREATE_ON_HEAP;
 	};
@@ -0,0 +1,28 @@
+# BmlDictTrainer, siehe main.cpp
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TARGET = BmlDictTrainer
+TEMPLATE = app
+
+# Erwartet das Verzeichnis Stream neben den anderen Modulen, wie bei Stream.pri
+INCLUDEPATH += ../..
+DEFINES += STREAM_USE_ZSTD
+LIBS += -lzstd
+
+SOURCES += main.cpp \
+    ../Codec.cpp \
+    ../DataCell.cpp \
+    ../DataReader.cpp \
+    ../Helper.cpp \
+    ../NameTag.cpp \
+    ../TimeSlot.cpp
+
+HEADERS += \
+    ../Codec.h \
+    ../DataCell.h \
+    ../DataReader.h \
+    ../Exceptions.h \
+    ../Helper.h \
+    ../NameTag.h \
+    ../TimeSlot.h
@@ -0,0 +1,123 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include <Stream/DataReader.h>
+#include <Stream/Exceptions.h>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <zdict.h>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace Stream;
+
+// Trainiert ein zstd-Wrterbuch aus den String- und Binrwerten von BML-Dateien. Jeder Wert
+// ist ein Sample, und zwar so, wie ihn DataCell komprimieren wrde. Das Resultat wird mit
+// Codec::registerDictionary( Codec::Zstd, ... ) bei Writer und Reader registriert.
+
+static void usage()
+{
+	fprintf( stderr, "usage: BmlDictTrainer [-o dictfile] [-s maxbytes] file.bml...\n" );
+}
+
+static bool collect( const QString& path, QByteArray& samples, QList<size_t>& sizes )
+{
+	QFile f( path );
+	if( !f.open( QIODevice::ReadOnly ) )
+	{
+		fprintf( stderr, "cannot open %s\n", path.toLocal8Bit().constData() );
+		return false;
+	}
+	try
+	{
+		DataReader r( &f );
+		DataReader::Token t = r.nextToken();
+		while( DataReader::isUseful( t ) )
+		{
+			if( t == DataReader::Slot )
+			{
+				const DataCell v = r.readValue();
+				const int len = DataCell::typeByteCount[ v.getType() ];
+				if( len == DataCell::UNISTR || len == DataCell::CSTRING || len == DataCell::BINARY )
+				{
+					const QByteArray data = v.writeCell( true );
+					samples.append( data );
+					sizes.append( data.size() );
+				}
+			}
+			t = r.nextToken();
+		}
+	}catch( const StreamException& e )
+	{
+		fprintf( stderr, "%s: %s\n", path.toLocal8Bit().constData(), e.getMsg().toLocal8Bit().constData() );
+		return false;
+	}
+	return true;
+}
+
+int main( int argc, char* argv[] )
+{
+	QString out = "bml.dict";
+	size_t maxSize = 64 * 1024;
+	QByteArray samples;
+	QList<size_t> sizes;
+	for( int i = 1; i < argc; i++ )
+	{
+		const QByteArray arg = argv[i];
+		if( arg == "-o" && i + 1 < argc )
+			out = QString::fromLocal8Bit( argv[++i] );
+		else if( arg == "-s" && i + 1 < argc )
+			maxSize = ::atoi( argv[++i] );
+		else if( arg.startsWith( '-' ) )
+		{
+			usage();
+			return 1;
+		}else if( !collect( QString::fromLocal8Bit( arg ), samples, sizes ) )
+			return 1;
+	}
+	if( sizes.isEmpty() || maxSize == 0 )
+	{
+		usage();
+		return 1;
+	}
+
+	QByteArray dict( int(maxSize), 0 );
+	QVector<size_t> sampleSizes( sizes.size() );
+	for( int i = 0; i < sizes.size(); i++ )
+		sampleSizes[i] = sizes[i];
+	const size_t n = ::ZDICT_trainFromBuffer( dict.data(), maxSize, samples.constData(),
+											  sampleSizes.constData(), sampleSizes.size() );
+	if( ::ZDICT_isError( n ) )
+	{
+		fprintf( stderr, "training failed: %s\n", ::ZDICT_getErrorName( n ) );
+		return 1;
+	}
+	dict.resize( int(n) );
+
+	QFile f( out );
+	if( !f.open( QIODevice::WriteOnly ) || f.write( dict ) != dict.size() )
+	{
+		fprintf( stderr, "cannot write %s\n", out.toLocal8Bit().constData() );
+		return 1;
+	}
+	printf( "%s: %d samples, %d bytes, dictionary id %u\n", out.toLocal8Bit().constData(),
+			sizes.size(), dict.size(), ::ZDICT_getDictID( dict.constData(), dict.size() ) );
+	return 0;
+}
@@ -84,6 +84,14 @@ quint32 Helper::writeMultibyte29( QIODevice* out, quint32 i )
 	return res;
 }
 
+quint32 Helper::writeMultibyte29( QByteArray& out, quint32 i )
+{
+	char buf[multiByte29MaxLen];
+	const quint32 res = writeMultibyte29( buf, i );
+	out.append( buf, res );
+	return res;
+}
+
 quint32 Helper::writeMultibyte32( char* out, quint32 i )
 {
 	// Wie Helper::writeMultibyte, analog erweitert
@@ -131,6 +139,14 @@ quint32 Helper::writeMultibyte32( QIODevice* out, quint32 i )
 	return res;
 }
 
+quint32 Helper::writeMultibyte32( QByteArray& out, quint32 i )
+{
+	char buf[multiByte32MaxLen];
+	const quint32 res = writeMultibyte32( buf, i );
+	out.append( buf, res );
+	return res;
+}
+
 
 int Helper::readMultibyte29( QIODevice* in, quint32& out )
 {
@@ -160,7 +176,7 @@ int Helper::peekMultibyte29( const char* buf, int count )
 	if( n < ( multiByte29MaxLen - 1 ) )
 	{
 		// n==0, 1 oder 2
-		if( count < n || ( buf[ n ] & 0x80 ) != 0 )
+		if( count <= n || ( buf[ n ] & 0x80 ) != 0 )
 			return -1; // Es fehlen noch Bytes
 	}
 	n++;
@@ -387,6 +403,14 @@ quint32 Helper::writeMultibyte64( QIODevice* out, quint64 i )
 	return res;
 }
 
+quint32 Helper::writeMultibyte64( QByteArray& out, quint64 i )
+{
+	char buf[multiByte64MaxLen];
+	const quint32 res = writeMultibyte64( buf, i );
+	out.append( buf, res );
+	return res;
+}
+
 int Helper::readMultibyte64( QIODevice* in, quint64& out )
 {
 	char buf[multiByte64MaxLen];
@@ -414,7 +438,7 @@ int Helper::peekMultibyte64( const char* buf, int count )
 	}
 	if( n < ( multiByte64MaxLen - 1 ) )
 	{
-		if( count < n || ( buf[ n ] & 0x80 ) != 0 )
+		if( count <= n || ( buf[ n ] & 0x80 ) != 0 )
 			return -1; // Es fehlen noch Bytes
 	}
 	n++;
@@ -470,7 +494,7 @@ int Helper::peekMultibyte32( const char* buf, int count )
 	if( n < ( multiByte32MaxLen - 1 ) )
 	{
 		// n==0, 1 oder 2
-		if( count < n || ( buf[ n ] & 0x80 ) != 0 )
+		if( count <= n || ( buf[ n ] & 0x80 ) != 0 )
 			return -1; // Es fehlen noch Bytes
 	}
 	n++;
@@ -21,6 +21,7 @@
 */
 
 #include <QIODevice>
+#include <QByteArray>
 
 namespace Stream
 {
@@ -71,6 +72,17 @@ namespace Stream
 			return sizeof(T);
 		}
 
+		template<class T>
+		static quint32 write( QByteArray& out, T i )
+		{
+			// Hngt an out an
+			char buf[sizeof(T)];
+			::memcpy( buf, (char*)(&i), sizeof(T) );
+			adjustSex( buf, sizeof(T) );
+			out.append( buf, sizeof(T) );
+			return sizeof(T);
+		}
+
 		template<class T>
 		static quint32 write( char* out, T i )
 		{
@@ -82,10 +94,87 @@ namespace Stream
 
 		static quint32 writeMultibyte29( char* out, quint32 i ); 
 		static quint32 writeMultibyte29( QIODevice* out, quint32 i ); 
+		static quint32 writeMultibyte29( QByteArray& out, quint32 i ); 
 		static quint32 writeMultibyte32( char* out, quint32 i );
 		static quint32 writeMultibyte32( QIODevice* out, quint32 i );
+		static quint32 writeMultibyte32( QByteArray& out, quint32 i );
 		static quint32 writeMultibyte64( char* out, quint64 i );
 		static quint32 writeMultibyte64( QIODevice* out, quint64 i );
+		static quint32 writeMultibyte64( QByteArray& out, quint64 i );
+
+		// Varianten ber eine Source bzw. Sink (siehe IoPolicy.h); werden beim Instanzieren
+		// inline. get liefert false bzw. -1, wenn die Daten vorher enden; die bis dahin
+		// gelesenen Bytes sind konsumiert.
+		template<class Source, class T>
+		static bool get( Source& in, T& i )
+		{
+			char buf[sizeof(T)];
+			if( in.read( buf, sizeof(T) ) != qint64(sizeof(T)) )
+				return false;
+			adjustSex( buf, sizeof(T) );
+			::memcpy( (char*)(&i), buf, sizeof(T) );
+			return true;
+		}
+
+		template<class Source>
+		static int getMultibyte32( Source& in, quint32& i )
+		{
+			char buf[multiByte32MaxLen];
+			int count = 0;
+			int n;
+			do
+			{
+				if( count >= multiByte32MaxLen || !in.getChar( buf[count] ) )
+					return -1;
+				count++;
+				n = peekMultibyte32( buf, count );
+			}while( n < 0 );
+			return readMultibyte32( buf, i, n );
+		}
+
+		template<class Source>
+		static int getMultibyte64( Source& in, quint64& i )
+		{
+			char buf[multiByte64MaxLen];
+			int count = 0;
+			int n;
+			do
+			{
+				if( count >= multiByte64MaxLen || !in.getChar( buf[count] ) )
+					return -1;
+				count++;
+				n = peekMultibyte64( buf, count );
+			}while( n < 0 );
+			return readMultibyte64( buf, i, n );
+		}
+
+		template<class Sink, class T>
+		static quint32 put( Sink& out, T i )
+		{
+			char buf[sizeof(T)];
+			::memcpy( buf, (char*)(&i), sizeof(T) );
+			adjustSex( buf, sizeof(T) );
+			out.write( buf, sizeof(T) );
+			return sizeof(T);
+		}
+
+		template<class Sink>
+		static quint32 putMultibyte32( Sink& out, quint32 i )
+		{
+			char buf[multiByte32MaxLen];
+			const quint32 res = writeMultibyte32( buf, i );
+			out.write( buf, res );
+			return res;
+		}
+
+		template<class Sink>
+		static quint32 putMultibyte64( Sink& out, quint64 i )
+		{
+			char buf[multiByte64MaxLen];
+			const quint32 res = writeMultibyte64( buf, i );
+			out.write( buf, res );
+			return res;
+		}
 
 		static void adjustSex( char* ptr, quint32 len );
 
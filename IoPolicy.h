@@ -0,0 +1,239 @@
+#ifndef __stream_iopolicy__
+#define __stream_iopolicy__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Stream/Exceptions.h>
+#include <QIODevice>
+#include <QByteArray>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace Stream
+{
+	// Policies fr die Templates Helper::get/put und DataCell::readFrom/writeTo. Alle Methoden
+	// sind inline, damit beim Instanzieren die Byte-Primitive ohne virtuelle Aufrufe auskommen.
+	//
+	// Eine Source hat
+	//   bool getChar( char& );					false..keine Daten mehr
+	//   qint64 read( char*, qint64 n );		liefert weniger als n nur am Ende der Daten, -1..Fehler
+	//   const char* direct( quint64& len );	Zeiger auf die restlichen Daten am Stck oder 0
+	//   void skip( quint64 n );				nur nach direct, berspringt n Bytes davon
+	// Eine Sink hat
+	//   void putChar( char );
+	//   void write( const char*, qint64 );
+	//   QByteArray* direct();					Puffer, an den direkt angehngt wird, oder 0
+	// Fehler des Gerts werden als StreamException::DeviceAccess geworfen.
+
+	// Value Class
+	// Liest aus zusammenhngendem Speicher, der whrend des Lesens gltig bleiben muss.
+	class MemorySource
+	{
+	public:
+		MemorySource( const char* data, quint64 len ):d_cur( data ),d_end( data + len ) {}
+		MemorySource( const QByteArray& data ):d_cur( data.constData() ),d_end( data.constData() + data.size() ) {}
+		bool getChar( char& c )
+		{
+			if( d_cur >= d_end )
+				return false;
+			c = *d_cur++;
+			return true;
+		}
+		qint64 read( char* to, qint64 n )
+		{
+			if( n > d_end - d_cur )
+				n = d_end - d_cur;
+			::memcpy( to, d_cur, n );
+			d_cur += n;
+			return n;
+		}
+		const char* direct( quint64& len ) { len = d_end - d_cur; return d_cur; }
+		void skip( quint64 n ) { Q_ASSERT( n <= quint64( d_end - d_cur ) ); d_cur += n; }
+		const char* getPos() const { return d_cur; }
+		bool atEnd() const { return d_cur >= d_end; }
+	private:
+		const char* d_cur;
+		const char* d_end;
+	};
+
+	// Value Class
+	// Hngt an einen QByteArray an, der dem Aufrufer gehrt.
+	class BufferSink
+	{
+	public:
+		BufferSink( QByteArray& out ):d_out( out ) {}
+		void putChar( char c ) { d_out.append( c ); }
+		void write( const char* data, qint64 len ) { d_out.append( data, len ); }
+		QByteArray* direct() { return &d_out; }
+	private:
+		QByteArray& d_out;
+	};
+
+	// Adapter fr QIODevice; die Primitive bleiben hier virtuelle Aufrufe.
+	class DeviceSource
+	{
+	public:
+		DeviceSource( QIODevice* in ):d_in( in ) { Q_ASSERT( in != 0 ); }
+		bool getChar( char& c ) { return d_in->getChar( &c ); }
+		qint64 read( char* to, qint64 n )
+		{
+			const qint64 r = d_in->read( to, n );
+			if( r < 0 )
+				throw StreamException( StreamException::DeviceAccess, "cannot read device" );
+			return r;
+		}
+		const char* direct( quint64& len ) { len = 0; return 0; }
+		void skip( quint64 ) { Q_ASSERT( false ); }
+	private:
+		QIODevice* d_in;
+	};
+
+	class DeviceSink
+	{
+	public:
+		DeviceSink( QIODevice* out ):d_out( out ) { Q_ASSERT( out != 0 ); }
+		void putChar( char c ) { write( &c, 1 ); }
+		void write( const char* data, qint64 len )
+		{
+			if( d_out->write( data, len ) != len )
+				throw StreamException( StreamException::DeviceAccess, "cannot write device" );
+		}
+		QByteArray* direct() { return 0; }
+	private:
+		QIODevice* d_out;
+	};
+
+#ifdef Q_OS_UNIX
+	// Liest gepuffert von einem POSIX File Descriptor, der dem Aufrufer gehrt. Es wird
+	// blockierend gelesen; was im Puffer brig bleibt, ist fr den Descriptor verloren.
+	class FdSource
+	{
+	public:
+		FdSource( int fd ):d_fd( fd ),d_cur( 0 ),d_end( 0 ) {}
+		bool getChar( char& c )
+		{
+			if( d_cur >= d_end && !fill() )
+				return false;
+			c = d_buf[d_cur++];
+			return true;
+		}
+		qint64 read( char* to, qint64 n )
+		{
+			qint64 res = 0;
+			while( res < n && ( d_cur < d_end || fill() ) )
+			{
+				const qint64 len = qMin( n - res, qint64( d_end - d_cur ) );
+				::memcpy( to + res, d_buf + d_cur, len );
+				d_cur += len;
+				res += len;
+			}
+			return res;
+		}
+		const char* direct( quint64& len ) { len = 0; return 0; }
+		void skip( quint64 ) { Q_ASSERT( false ); }
+	private:
+		FdSource( const FdSource& );
+		FdSource& operator=( const FdSource& );
+		bool fill()
+		{
+			ssize_t r;
+			do
+			{
+				r = ::read( d_fd, d_buf, sizeof(d_buf) );
+			}while( r < 0 && errno == EINTR );
+			if( r < 0 )
+				throw StreamException( StreamException::DeviceAccess, "cannot read file descriptor" );
+			d_cur = 0;
+			d_end = r;
+			return r > 0;
+		}
+		int d_fd;
+		int d_cur;
+		int d_end;
+		char d_buf[4096];
+	};
+
+	// Schreibt gepuffert auf einen POSIX File Descriptor; flush sptestens im Destruktor.
+	class FdSink
+	{
+	public:
+		FdSink( int fd ):d_fd( fd ),d_len( 0 ) {}
+		~FdSink()
+		{
+			try
+			{
+				flush();
+			}catch( ... )
+			{
+			}
+		}
+		void putChar( char c )
+		{
+			if( d_len >= int(sizeof(d_buf)) )
+				flush();
+			d_buf[d_len++] = c;
+		}
+		void write( const char* data, qint64 len )
+		{
+			if( d_len + len > qint64(sizeof(d_buf)) )
+			{
+				flush();
+				if( len >= qint64(sizeof(d_buf)) )
+				{
+					writeAll( data, len );
+					return;
+				}
+			}
+			::memcpy( d_buf + d_len, data, len );
+			d_len += len;
+		}
+		QByteArray* direct() { return 0; }
+		void flush()
+		{
+			const int len = d_len;
+			d_len = 0;
+			writeAll( d_buf, len );
+		}
+	private:
+		FdSink( const FdSink& );
+		FdSink& operator=( const FdSink& );
+		void writeAll( const char* data, qint64 len )
+		{
+			while( len > 0 )
+			{
+				const ssize_t r = ::write( d_fd, data, len );
+				if( r < 0 && errno == EINTR )
+					continue;
+				if( r <= 0 )
+					throw StreamException( StreamException::DeviceAccess, "cannot write file descriptor" );
+				data += r;
+				len -= r;
+			}
+		}
+		int d_fd;
+		int d_len;
+		char d_buf[4096];
+	};
+#endif
+}
+
+#endif // __stream_iopolicy__
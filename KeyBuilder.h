@@ -0,0 +1,49 @@
+#ifndef __stream_keybuilder__
+#define __stream_keybuilder__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include <Stream/DataCell.h>
+
+namespace Stream
+{
+	// Value Class
+	// Baut einen zusammengesetzten Schlssel aus mehreren Zellen (siehe DataCell::writeKey). Die
+	// Schlssel zweier Builder lassen sich mit memcmp vergleichen und ergeben die Reihenfolge der
+	// ersten Zelle, bei Gleichheit die der zweiten usw.; ein Prfix steht vor seinen Verlngerungen.
+	class KeyBuilder
+	{
+	public:
+		KeyBuilder() {}
+		KeyBuilder& add( const DataCell& v, bool descending = false )
+		{
+			v.writeKey( d_key, descending );
+			return *this;
+		}
+		const QByteArray& getKey() const { return d_key; }
+		void clear() { d_key.clear(); }
+		bool isEmpty() const { return d_key.isEmpty(); }
+	private:
+		QByteArray d_key;
+	};
+}
+
+#endif // __stream_keybuilder__
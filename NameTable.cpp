@@ -0,0 +1,75 @@
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include "NameTable.h"
+#include "Exceptions.h"
+#include <QMap>
+using namespace Stream;
+
+typedef QMap<QByteArray, QMap<quint16,NameTable> > _Tables; // Id -> Version -> Tabelle
+
+static _Tables& _tables()
+{
+	static _Tables s_tables;
+	return s_tables;
+}
+
+NameTable::NameTable( const QByteArray& id, quint16 version, const char* const* names ):
+	d_id( id ), d_version( version )
+{
+	while( names && *names )
+		add( *names++ );
+}
+
+quint32 NameTable::add( const QByteArray& name )
+{
+	if( name.isEmpty() )
+		throw StreamException( StreamException::WrongDataFormat, "NameTable: empty name" );
+	QHash<QByteArray,quint32>::const_iterator i = d_index.constFind( name );
+	if( i != d_index.constEnd() )
+		return i.value();
+	const quint32 res = d_names.size();
+	d_names.append( name );
+	d_index[name] = res;
+	return res;
+}
+
+int NameTable::indexOf( const QByteArray& name ) const
+{
+	QHash<QByteArray,quint32>::const_iterator i = d_index.constFind( name );
+	if( i == d_index.constEnd() )
+		return -1;
+	return i.value();
+}
+
+void NameTable::registerTable( const NameTable& t )
+{
+	_tables()[t.d_id][t.d_version] = t;
+}
+
+NameTable NameTable::getTable( const QByteArray& id, quint16 version )
+{
+	return _tables().value( id ).value( version );
+}
+
+bool NameTable::hasTable( const QByteArray& id, quint16 version )
+{
+	return _tables().value( id ).contains( version );
+}
@@ -0,0 +1,65 @@
+#ifndef __stream_nametable__
+#define __stream_nametable__
+
+/*
+* Copyright 2005-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the DoorScope Stream library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+
+namespace Stream
+{
+	// Value Class
+	// Vorgegebene Stringtabelle fr FrameNameIdx und SlotNameIdx. Writer und Leser mssen sich
+	// ausserhalb des Streams auf dieselbe Tabelle (Id und Version) einigen; der Stream selber
+	// enthlt keinen Hinweis darauf. Die Namen der Tabelle belegen die Indizes 0..size()-1 und
+	// werden schon beim ersten Vorkommen als Index geschrieben; im Stream neu definierte Namen
+	// erhalten die folgenden Indizes. Eine einmal verwendete Version darf nicht mehr gendert,
+	// sondern nur unter einer neuen Version erweitert werden.
+	class NameTable
+	{
+	public:
+		NameTable():d_version(0) {}
+		NameTable( const QByteArray& id, quint16 version, const char* const* names = 0 ); // names..mit 0 abgeschlossen
+
+		quint32 add( const QByteArray& name ); // returns Index; existiert der Name schon, dessen Index
+		const QByteArray& getId() const { return d_id; }
+		quint16 getVersion() const { return d_version; }
+		int size() const { return d_names.size(); }
+		bool isEmpty() const { return d_names.isEmpty(); }
+		const QByteArray& getName( quint32 i ) const { return d_names[i]; }
+		const QList<QByteArray>& getNames() const { return d_names; }
+		int indexOf( const QByteArray& name ) const; // -1..nicht enthalten
+
+		// Die Registry ist nicht synchronisiert; Tabellen sollen vor dem ersten Lesen oder
+		// Schreiben registriert werden. Eine Tabelle mit gleicher Id und Version wird ersetzt.
+		static void registerTable( const NameTable& );
+		static NameTable getTable( const QByteArray& id, quint16 version ); // leer..nicht registriert
+		static bool hasTable( const QByteArray& id, quint16 version );
+	private:
+		QByteArray d_id;
+		QList<QByteArray> d_names;
+		QHash<QByteArray,quint32> d_index;
+		quint16 d_version;
+	};
+}
+
+#endif // __stream_nametable__
@@ -23,11 +23,6 @@ using namespace Stream;
 
 const NameTag NameTag::null;
 
-NameTag::NameTag()
-{
-	setNull();
-}
-
 void NameTag::setNull()
 {
 	d_id = 0;
@@ -35,10 +30,7 @@ void NameTag::setNull()
 
 NameTag& NameTag::operator=( const char* str )
 {
-	const int len = ::strlen( str );
-	d_id = 0;
-	for( int i = 0; i < len && i < Size; i++ )
-		d_tag[ i ] = str[ i ];
+	d_id = id( str );
 	return *this;
 }
 
@@ -47,18 +39,6 @@ bool NameTag::equals( const char* str ) const
 	return *this == NameTag( str );
 }
 
-NameTag::NameTag( const char* str )
-{
-	setNull();
-	*this = str;
-}
-
-NameTag::NameTag( quint32 id )
-{
-	setNull();
-	d_id = id;
-}
-
 QByteArray NameTag::toByteArray() const
 {
 	char buf[ Size + 1 ];
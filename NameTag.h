@@ -21,6 +21,7 @@
 */
 
 #include <QString>
+#include <QSysInfo>
 
 namespace Stream
 {
@@ -50,13 +51,40 @@ namespace Stream
 		bool operator<( const NameTag& rhs ) const { return d_id < rhs.d_id; }
 		bool equals( const char* ) const;
 
-		NameTag();
-		NameTag( const char* ); // von String
-		NameTag( quint32 ); // von Id
+		Q_DECL_CONSTEXPR NameTag():d_id(0) {}
+		Q_DECL_CONSTEXPR NameTag( const char* str ):d_id( id( str ) ) {} // von String
+		Q_DECL_CONSTEXPR NameTag( quint32 i ):d_id( i ) {} // von Id
+
+		// Wie NameTag( str ).d_id, aber ab C++11 ein konstanter Ausdruck und damit als case-Label
+		// verwendbar (siehe tagOf). Wie bisher zhlen hchstens die ersten Size Zeichen; der Rest ist 0.
+		static Q_DECL_CONSTEXPR quint32 id( const char* str, int i = 0 )
+		{
+			return ( i >= Size || str[i] == 0 )?0:
+				( quint32( quint8( str[i] ) ) << ( 8 * ( ( QSysInfo::ByteOrder == QSysInfo::BigEndian )?
+				Size - 1 - i:i ) ) ) | id( str, i + 1 );
+		}
 
 		static const NameTag null;
 	};
 
+	// Verteilt den Namen eines Frames oder Slots per switch direkt auf die Handler statt mit
+	// einer if-Kette; die Labels sind Konstanten, der Compiler macht daraus eine Sprungtabelle
+	// oder eine binre Suche. Name ist z.B. DataReader::getName() oder BmlParser::Name; fr
+	// BmlView siehe dort. Namen, die kein Tag sind (FrameName, FrameNameStr etc.), ergeben 0.
+	//   switch( tagOf( reader.getName() ) )
+	//   {
+	//   case NameTag::id( "TST" ): readTst( reader ); break;
+	//   case "ABC"_tag.d_id: readAbc( reader ); break;
+	//   default: ...
+	//   }
+	template<class Name>
+	inline quint32 tagOf( const Name& name ) { return name.getTag().d_id; }
+
+#if __cplusplus >= 201103L
+	// "TST"_tag ist ein konstanter NameTag, z.B. writeSlot( v, "TST"_tag )
+	constexpr NameTag operator"" _tag( const char* str, size_t ) { return NameTag( str ); }
+#endif
+
 }
 
 #endif // __stream_nametag__
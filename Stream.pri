@@ -1,19 +1,35 @@
 SOURCES += \
+    ../Stream/BmlMappedFile.cpp \
+    ../Stream/BmlParser.cpp \
     ../Stream/BmlRecord.cpp \
+    ../Stream/BmlView.cpp \
+    ../Stream/Codec.cpp \
     ../Stream/DataCell.cpp \
     ../Stream/DataReader.cpp \
     ../Stream/DataWriter.cpp \
     ../Stream/Helper.cpp \
+    ../Stream/NameTable.cpp \
     ../Stream/NameTag.cpp \
     ../Stream/TimeSlot.cpp
 
 HEADERS += \
+    ../Stream/BmlMappedFile.h \
+    ../Stream/BmlParser.h \
     ../Stream/BmlRecord.h \
+    ../Stream/BmlView.h \
+    ../Stream/Codec.h \
     ../Stream/DataCell.h \
     ../Stream/DataReader.h \
     ../Stream/DataWriter.h \
     ../Stream/Exceptions.h \
     ../Stream/Helper.h \
+    ../Stream/IoPolicy.h \
+    ../Stream/KeyBuilder.h \
+    ../Stream/NameTable.h \
     ../Stream/NameTag.h \
     ../Stream/TimeSlot.h
 
+
+# Optionale Codecs, siehe Codec.h
+contains( DEFINES, STREAM_USE_ZSTD ): LIBS += -lzstd
+contains( DEFINES, STREAM_USE_LZ4 ): LIBS += -llz4